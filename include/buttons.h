@@ -0,0 +1,57 @@
+// buttons.h
+// Push buttons sampled from the HAL tick interrupt. Presses are debounced
+// by timestamp, and held buttons can auto-repeat. Events go into a small
+// lock-free ring that loop() drains, so a press made while loop() is busy
+// with a redraw or a seek is handled afterwards instead of being missed.
+//
+// The Mega's button pins (22-24, port A) have no pin-change interrupt, so
+// the pins are sampled at the ~1 ms tick rather than on the edge.
+
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include "hal.h"
+
+// Maximum number of buttons
+#define BUTTONS_MAX           8
+
+// Events buffered between the tick and loop() (power of two, ≤ 128)
+#define BUTTONS_QUEUE_SIZE    16
+
+// Level changes closer than this to the previous accepted one are bounce
+#define BUTTONS_DEBOUNCE_MS   20
+
+// Hold time before the first repeat, and the interval between repeats
+#define BUTTONS_REPEAT_DELAY_MS  500
+#define BUTTONS_REPEAT_MS        150
+
+struct ButtonEvent {
+    uint8_t button;     // Index into the pins passed to buttons_begin()
+    bool    repeat;     // Auto-repeat of a held button
+};
+
+/**
+ * @brief Configure the pins (active low, pull-ups on) and start sampling.
+ *
+ * @param pins        Button pins, indexed by ButtonEvent::button.
+ * @param count       Number of pins (≤ BUTTONS_MAX).
+ * @param repeatMask  Bit i set: button i auto-repeats while held.
+ */
+void buttons_begin(const uint8_t* pins, uint8_t count, uint8_t repeatMask);
+
+/**
+ * @brief Take the oldest press from the queue.
+ *
+ * @return false if no press is pending.
+ */
+bool buttons_pop(ButtonEvent* ev);
+
+/**
+ * @brief Presses lost because the queue was full.
+ *
+ * Repeats are only queued while the queue is at most half full, so only a
+ * burst of real presses can be dropped.
+ */
+uint16_t buttons_dropped(void);
+
+#endif // BUTTONS_H
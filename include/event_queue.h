@@ -0,0 +1,82 @@
+// event_queue.h
+// Fixed-size ring of pre-parsed NoteEvents between the SD reader and the
+// note scheduler. The scheduler only pops from RAM; loop() refills the ring
+// from the SD card in bounded slices.
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include "hal.h"
+#include "sd_card.h"
+
+// Capacity of the ring (must be a power of two, at most 128)
+#define EVENT_QUEUE_SIZE     32
+
+// Default number of events parsed per event_queue_refill() call
+#define EVENT_QUEUE_SLICE    4
+
+/**
+ * @brief Empty the queue and clear the underrun counter.
+ */
+void event_queue_reset(void);
+
+/**
+ * @brief Parse up to maxEvents events from the open song into the queue.
+ *
+ * Stops early when the queue is full or the song is exhausted.
+ *
+ * @param maxEvents  Upper bound on SD reads performed by this call.
+ * @return Number of events added.
+ */
+uint8_t event_queue_refill(uint8_t maxEvents);
+
+/**
+ * @brief Append an event obtained elsewhere (e.g. while seeking).
+ * @return false if the queue is full.
+ */
+bool event_queue_push(const NoteEvent* e);
+
+/**
+ * @brief Look at the oldest queued event without removing it.
+ *
+ * For queries such as the next deadline; safe from either side.
+ *
+ * @return Pointer to the event, or nullptr if the queue is empty.
+ */
+const NoteEvent* event_queue_peek(void);
+
+/**
+ * @brief The oldest queued event if it is due by now (scheduler side).
+ *
+ * Finding the queue empty while the song still has unread events marks it
+ * starved at now. The first event queued after that counts as an underrun
+ * if it was already due at the last such time, i.e. its start passed while
+ * the scheduler had nothing to play.
+ *
+ * @param now  Current song time.
+ * @return Pointer to the event, or nullptr if none is queued or due.
+ */
+const NoteEvent* event_queue_peek_due(unsigned long now);
+
+/**
+ * @brief Remove the oldest queued event.
+ */
+void event_queue_pop(void);
+
+/**
+ * @brief Number of events currently queued.
+ */
+uint8_t event_queue_count(void);
+
+/**
+ * @brief Whether every event of the song has been queued and consumed.
+ */
+bool event_queue_drained(void);
+
+/**
+ * @brief Number of events whose start passed while the queue was empty
+ *        (see event_queue_peek_due()), since the last reset.
+ */
+uint16_t event_queue_underruns(void);
+
+#endif // EVENT_QUEUE_H
@@ -0,0 +1,264 @@
+// hal.h
+// Thin hardware abstraction layer for the player core.
+//
+// player.cpp, sd_card.cpp, logger.cpp and the modules they depend on only
+// talk to the hardware through this header: clock, console, tone output,
+// input pins and file storage. hal_arduino.cpp implements it on top of the
+// Arduino core, SD and Tone libraries; native/hal_native.cpp implements it
+// on the host (env:native) with the system clock, stdio and a directory
+// standing in for the SD card. The display is abstracted by oled_gui.h, which the native
+// build backs with a console implementation.
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <SD.h>
+#else
+#include <strings.h>
+#include <math.h>
+// Flash-resident strings and tables are plain memory on the host
+#define F(s) (s)
+#define PROGMEM
+#define pgm_read_byte(addr)  (*(const uint8_t*)(addr))
+#define pgm_read_word(addr)  (*(const uint16_t*)(addr))
+#endif
+
+// Maximum number of tone voices the HAL can drive
+#define HAL_MAX_VOICES  8
+
+/// @name Clock
+/// @{
+
+/**
+ * @brief Milliseconds since start-up (wraps like Arduino millis()).
+ */
+uint32_t hal_millis(void);
+
+/**
+ * @brief Microseconds since start-up (wraps like Arduino micros()).
+ */
+uint32_t hal_micros(void);
+
+/**
+ * @brief Make sure interrupts are enabled (Tone output depends on them).
+ */
+void hal_enable_interrupts(void);
+
+/**
+ * @brief Disable interrupts and return the previous state.
+ *
+ * Pair with hal_irq_restore() around data shared with the scheduler timer.
+ */
+uint8_t hal_irq_save(void);
+
+/**
+ * @brief Restore the interrupt state returned by hal_irq_save().
+ */
+void hal_irq_restore(uint8_t state);
+
+// Compiler barrier: memory accesses are not reordered across it
+#define HAL_BARRIER()  __asm__ __volatile__("" ::: "memory")
+
+/// @}
+
+/// @name Scheduler timer
+/// @{
+
+// Called from interrupt context (with other interrupts enabled) when an
+// armed deadline passes
+typedef void (*HalTimerCallback)(void);
+
+/**
+ * @brief Install the scheduler timer callback. The timer starts disarmed.
+ */
+void hal_timer_begin(HalTimerCallback fn);
+
+/**
+ * @brief Fire the callback once, delayUs microseconds from now.
+ *
+ * Re-arming from inside the callback is allowed and replaces any pending
+ * deadline.
+ */
+void hal_timer_arm(uint32_t delayUs);
+
+/**
+ * @brief Cancel a pending deadline. The callback is not running afterwards.
+ */
+void hal_timer_disarm(void);
+
+/**
+ * @brief Install a periodic tick callback, run at least every ~1 ms.
+ *
+ * Shares the scheduler timer's interrupt, so it runs with interrupts off
+ * and must be short. Calls may come closer together than 1 ms.
+ */
+void hal_tick_begin(HalTimerCallback fn);
+
+/// @}
+
+/// @name Input pins
+/// @{
+
+/**
+ * @brief Configure a pin as an input with the internal pull-up enabled.
+ */
+void hal_input_begin(uint8_t pin);
+
+/**
+ * @brief Current level of an input pin (true = high). Safe from the tick.
+ */
+bool hal_input_read(uint8_t pin);
+
+/// @}
+
+/// @name Console
+/// @{
+
+/**
+ * @brief Print text or an unsigned number on the debug console (Serial).
+ */
+void hal_print(const char* s);
+void hal_print(uint32_t v);
+void hal_println(const char* s);
+void hal_println(uint32_t v);
+#ifdef ARDUINO
+void hal_print(const __FlashStringHelper* s);
+void hal_println(const __FlashStringHelper* s);
+#endif
+
+/**
+ * @brief Write raw bytes to the console.
+ */
+size_t hal_write(const void* buf, size_t len);
+
+/**
+ * @brief Bytes the console accepts right now without blocking.
+ */
+size_t hal_write_room(void);
+
+/// @}
+
+/// @name Tone output
+/// @{
+
+/**
+ * @brief Attach tone voice `voice` (0..HAL_MAX_VOICES-1) to an output pin.
+ */
+void hal_tone_begin(uint8_t voice, uint8_t pin);
+
+/**
+ * @brief Start (or retune) a square wave of the given frequency on a voice.
+ *
+ * Retuning a sounding voice keeps its waveform running: on the board the
+ * new pitch takes effect at the next edge, so back-to-back notes don't
+ * click.
+ */
+void hal_tone_play(uint8_t voice, uint16_t frequency);
+
+/**
+ * @brief Start (or retune) a voice on a MIDI note (60 = C4, 69 = A4).
+ *
+ * Cheaper than hal_tone_play() on the board: the timer settings for every
+ * note are precomputed, so no division runs at note-on.
+ */
+void hal_tone_play_note(uint8_t voice, uint8_t note);
+
+/**
+ * @brief Silence a voice and drive its pin low.
+ */
+void hal_tone_stop(uint8_t voice);
+
+/**
+ * @brief Print the CPU time the tone outputs spend in interrupts on the
+ *        console (profiling builds; a note otherwise).
+ */
+void hal_tone_dump_load(void);
+
+/// @}
+
+/// @name File storage
+/// @{
+
+// Open modes for HalFile::open()
+enum HalFileMode {
+    HAL_FILE_READ,      // Read only, file must exist
+    HAL_FILE_RDWR,      // Read/write in place, file must exist
+    HAL_FILE_CREATE     // Read/write, created or truncated to zero length
+};
+
+/**
+ * @class HalFile
+ * @brief Handle to a file on the SD card (or the host directory standing in
+ *        for it). Mirrors the subset of the Arduino File API the core uses.
+ */
+class HalFile {
+public:
+    bool     open(const char* path, HalFileMode mode);
+    void     close(void);
+    bool     isOpen(void) const;
+    explicit operator bool(void) const { return isOpen(); }
+
+    /** @return Bytes read (0 at end of file, negative on error). */
+    int      read(void* buf, uint16_t len);
+    size_t   write(const void* buf, size_t len);
+    bool     seek(uint32_t pos);
+    uint32_t position(void);
+    uint32_t size(void);
+    void     flush(void);
+
+private:
+#ifdef ARDUINO
+    File file;
+#else
+    FILE* file = nullptr;
+#endif
+};
+
+/**
+ * @class HalDir
+ * @brief Iterator over the regular files of a directory.
+ */
+class HalDir {
+public:
+    bool open(const char* path);
+    /**
+     * @brief Fetch the next regular file name (directories are skipped).
+     * @return false when the listing is exhausted.
+     */
+    bool next(char* name, size_t len);
+    void close(void);
+
+private:
+#ifdef ARDUINO
+    File dir;
+#else
+    void* dir = nullptr;
+#endif
+};
+
+/**
+ * @brief Initialize the storage device (SD.begin on the board).
+ * @return true on success.
+ */
+bool hal_fs_begin(uint8_t csPin);
+
+/**
+ * @brief Whether a file exists.
+ */
+bool hal_fs_exists(const char* path);
+
+/**
+ * @brief Delete a file. Returns true if it was removed.
+ */
+bool hal_fs_remove(const char* path);
+
+/// @}
+
+#endif // HAL_H
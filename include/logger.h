@@ -1,8 +1,7 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <Arduino.h>
-#include <SD.h>
+#include "hal.h"
 
 // Maximum number of log entries to retain (older entries are overwritten circularly)
 #define LOG_MAX_ENTRIES 1000
@@ -10,6 +9,9 @@
 // Fixed byte size per record in the log file (including newline '\n')
 #define LOG_RECORD_SIZE 64
 
+// Records held in RAM until log_flush() writes them
+#define LOG_QUEUE_SIZE  4
+
 /**
  * @brief Initialize the logging system.
  *
@@ -23,15 +25,32 @@
 bool log_init(uint8_t csPin);
 
 /**
- * @brief Write an event message to the log file.
+ * @brief Queue an event message for the log file.
  *
- * Appends (or overwrites, in circular fashion) a single log entry containing:
+ * Builds a single log entry containing:
  *   [timestamp] msg\n
- * ensuring each record occupies exactly LOG_RECORD_SIZE bytes.
- * When reaching LOG_MAX_ENTRIES, wraps around to the beginning of the file.
+ * ensuring each record occupies exactly LOG_RECORD_SIZE bytes, and keeps it
+ * in RAM until log_flush(). Only when LOG_QUEUE_SIZE records are already
+ * waiting is the oldest one written to the card right away.
  *
  * @param msg  Null-terminated event description (up to ~LOG_RECORD_SIZE-20 bytes recommended).
  */
 void log_event(const char* msg);
 
+/**
+ * @brief Write the oldest queued entry to the log file.
+ *
+ * Appends (or overwrites, in circular fashion) the entry and flushes the
+ * card. When reaching LOG_MAX_ENTRIES, wraps around to the beginning of
+ * the file.
+ *
+ * @return false if no entry was queued.
+ */
+bool log_flush(void);
+
+/**
+ * @brief Number of entries queued and not yet written.
+ */
+uint8_t log_pending(void);
+
 #endif // LOGGER_H
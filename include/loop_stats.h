@@ -0,0 +1,55 @@
+// loop_stats.h
+// Timing of the phases of loop(): call count, min/avg/max and a log2
+// histogram of each phase's duration, plus a stall counter. Dumped and
+// reset from serial commands, so the phase behind an audible hiccup can be
+// identified on the device.
+
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include "hal.h"
+
+// Instrumented phases of loop()
+enum LoopPhase {
+    LOOP_PHASE_INPUT,    // Button handling
+    LOOP_PHASE_SERIAL,   // Serial commands and trace streaming
+    LOOP_PHASE_SEEK,     // Buffered seek
+    LOOP_PHASE_PLAYER,   // Event queue read-ahead (notes play from the timer)
+    LOOP_PHASE_GUI,      // Playback screen redraws
+    LOOP_PHASE_LOG,      // Writing queued log records to SD
+    LOOP_PHASE_COUNT
+};
+
+// Histogram buckets: bucket 0 counts 0 µs, bucket b counts
+// 2^(b-1)..2^b-1 µs, and the last bucket everything from 2^(N-2) µs (262 ms)
+#define LOOP_STATS_BUCKETS   20
+
+// A phase at least this long is counted as a stall (the event queue holds
+// only a few notes, so loop() being away this long risks an underrun)
+#define LOOP_STATS_STALL_US  20000UL
+
+/**
+ * @brief Clear all counters.
+ */
+void loop_stats_reset(void);
+
+/**
+ * @brief Mark the start of a phase.
+ */
+void loop_stats_begin(void);
+
+/**
+ * @brief Account the time since loop_stats_begin() (or the previous
+ *        loop_stats_end()) to a phase.
+ *
+ * The next phase may follow directly without another loop_stats_begin().
+ */
+void loop_stats_end(LoopPhase phase);
+
+/**
+ * @brief Print the table, the non-empty histogram buckets and the last
+ *        stall on the console.
+ */
+void loop_stats_dump(void);
+
+#endif // LOOP_STATS_H
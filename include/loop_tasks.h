@@ -0,0 +1,58 @@
+// loop_tasks.h
+// Tiny cooperative scheduler for loop(). Each pass runs a table of tasks in
+// priority order. A deferrable task is skipped while the time left before
+// the next note deadline is shorter than its budget, so slow, unimportant
+// work (redraws, SD log writes) waits for a gap in the music instead of
+// starving the read-ahead. A task skipped for maxDeferMs runs regardless.
+
+#ifndef LOOP_TASKS_H
+#define LOOP_TASKS_H
+
+#include "hal.h"
+#include "loop_stats.h"
+
+// Headroom meaning "no deadline pending"
+#define LOOP_TASKS_NO_DEADLINE  UINT32_MAX
+
+struct LoopTask {
+    const char* name;
+    // Does one slice of work within budgetUs where it can; returns false if
+    // there was nothing to do (the pass is then not timed)
+    bool      (*run)(uint16_t budgetUs);
+    uint8_t     priority;       // Higher runs first
+    uint16_t    budgetUs;       // Expected run time
+    uint16_t    maxDeferMs;     // 0: never deferred
+    LoopPhase   phase;          // loop_stats phase the run time is accounted to
+
+    // Bookkeeping, zero-initialise
+    uint32_t    lastRunMs;
+    uint16_t    deferrals;
+    uint16_t    forced;         // Runs after waiting maxDeferMs
+};
+
+/**
+ * @brief Sort a task table by priority, highest first, and clear its
+ *        counters. Call once before loop_tasks_run().
+ */
+void loop_tasks_init(LoopTask* tasks, uint8_t count);
+
+/**
+ * @brief Run one pass over the tasks.
+ *
+ * @param headroomUs  Real time until the next note deadline, or
+ *                    LOOP_TASKS_NO_DEADLINE. Time spent by earlier tasks in
+ *                    the pass is deducted before each deferrable task.
+ */
+void loop_tasks_run(LoopTask* tasks, uint8_t count, uint32_t headroomUs);
+
+/**
+ * @brief Print each task's deferral counters on the console.
+ */
+void loop_tasks_dump(const LoopTask* tasks, uint8_t count);
+
+/**
+ * @brief Clear the deferral counters.
+ */
+void loop_tasks_reset(LoopTask* tasks, uint8_t count);
+
+#endif // LOOP_TASKS_H
@@ -0,0 +1,41 @@
+// note_scheduler.h
+// Interrupt-driven note timing. While running, the HAL scheduler timer
+// fires at each note start/stop deadline and calls player_update() from
+// interrupt context, so note onsets no longer wait for loop() to get past
+// screen redraws or log writes. loop() only keeps the event queue filled.
+
+#ifndef NOTE_SCHEDULER_H
+#define NOTE_SCHEDULER_H
+
+#include "hal.h"
+
+// Re-check interval while the next event is still being read from SD
+#define NOTE_SCHED_IDLE_US  1000UL
+
+// Longest single wait before the next deadline is recomputed
+#define NOTE_SCHED_MAX_US   20000UL
+
+/**
+ * @brief Start scheduling notes of the current song at the play clock's
+ *        position. The play clock must be running.
+ */
+void note_scheduler_start(void);
+
+/**
+ * @brief Stop scheduling. Returns with no scheduler callback in progress,
+ *        so the player state may be changed freely afterwards.
+ */
+void note_scheduler_stop(void);
+
+/**
+ * @brief Recompute the next deadline now, e.g. after a tempo change moved
+ *        every pending deadline. Does nothing while stopped.
+ */
+void note_scheduler_rearm(void);
+
+/**
+ * @brief Whether the scheduler is running.
+ */
+bool note_scheduler_running(void);
+
+#endif // NOTE_SCHEDULER_H
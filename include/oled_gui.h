@@ -1,7 +1,23 @@
 #ifndef OLED_GUI_H
 #define OLED_GUI_H
 
-#include <Arduino.h>
+#include "hal.h"
+
+/**
+ * @struct OledStats
+ * @brief SPI traffic to the display, one frame per oled_show_*() call.
+ *
+ * @var frames      Number of frames drawn
+ * @var lastBytes   Bytes sent for the most recent frame
+ * @var maxBytes    Largest frame
+ * @var totalBytes  Bytes sent for all frames
+ */
+struct OledStats {
+    uint32_t frames;
+    uint32_t lastBytes;
+    uint32_t maxBytes;
+    uint32_t totalBytes;
+};
 
 /**
  * @brief Initialize the OLED/TFT display.
@@ -45,6 +61,8 @@ void oled_show_error(const char* msg);
  *
  * Renders a vertical list of playback option icons, highlights the selected one,
  * and displays filename, elapsed time, play/pause status, tempo, and transpose.
+ * When the playback screen is already showing the same song, only the parts
+ * that changed are repainted.
  *
  * @param opts       Array of null-terminated strings for playback option icons.
  * @param count      Number of options in opts[].
@@ -52,7 +70,7 @@ void oled_show_error(const char* msg);
  * @param filename   Name of the file being played (without ".csv").
  * @param playertime Current playback time in milliseconds.
  * @param status     Playback status flag (0 = playing, 1 = paused).
- * @param tempo      Current playback speed multiplier.
+ * @param tempo      Current playback speed in percent (100 = normal).
  * @param transpose  Current transpose offset in semitones.
  */
 void oled_show_playback_menu(const char* opts[],
@@ -61,7 +79,12 @@ void oled_show_playback_menu(const char* opts[],
                              const char* filename,
                              unsigned long playertime,
                              unsigned long status,
-                             double tempo,
+                             uint16_t tempo,
                              long transpose);
 
+/**
+ * @brief SPI traffic counters of the display (all zero on the host).
+ */
+const OledStats* oled_get_stats(void);
+
 #endif // OLED_GUI_H
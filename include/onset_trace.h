@@ -0,0 +1,73 @@
+// onset_trace.h
+// Note onset latency trace. While enabled, every note on and off played by
+// the scheduler is recorded in a RAM ring with its scheduled song time and
+// the song time at which it actually reached the buzzer. loop() streams the
+// ring out on the console as binary frames. Records that find the ring full
+// are dropped, which shows up as a gap in the sequence numbers.
+// tools/onset_report.py turns a capture into lateness percentiles.
+//
+// Frame layout (little-endian, ONSET_FRAME_SIZE bytes):
+//   uint8_t  sync[2]   ONSET_SYNC0, ONSET_SYNC1
+//   uint16_t seq       record number, wraps
+//   uint8_t  flags     bit 7 set for note off; bits 0..6 buzzer index (0-based)
+//   uint32_t due       scheduled song time (µs)
+//   uint32_t actual    song time when the buzzer was written (µs)
+//   uint8_t  check     sum of the bytes from seq to actual, mod 256
+// Frames are interleaved with ordinary text output; a song start is
+// announced by a "[TRACE] song <name>" line.
+
+#ifndef ONSET_TRACE_H
+#define ONSET_TRACE_H
+
+#include "hal.h"
+
+// Records buffered between the scheduler and loop() (power of two, ≤ 128)
+#define ONSET_TRACE_SIZE  32
+
+#define ONSET_SYNC0       0xA5
+#define ONSET_SYNC1       0x5A
+#define ONSET_FRAME_SIZE  14
+#define ONSET_FLAG_OFF    0x80
+
+/**
+ * @brief Turn tracing on or off. Either way the ring and sequence are reset.
+ */
+void onset_trace_enable(bool enabled);
+
+/**
+ * @brief Whether tracing is on.
+ */
+bool onset_trace_enabled(void);
+
+/**
+ * @brief Record a note on/off just written to a buzzer (scheduler side).
+ *
+ * Reads the play clock for the actual time; does nothing while tracing is
+ * off.
+ *
+ * @param voice  Buzzer index (0-based)
+ * @param off    true for note off
+ * @param due    Scheduled song time in µs
+ */
+void onset_trace_note(uint8_t voice, bool off, uint32_t due);
+
+/**
+ * @brief Announce the start of a song in the stream (after any pending
+ *        frames of the previous one).
+ */
+void onset_trace_song(const char* name);
+
+/**
+ * @brief Send buffered frames to the console.
+ *
+ * @param all  false: only as many as fit without blocking (call from
+ *             loop()); true: everything.
+ */
+void onset_trace_flush(bool all);
+
+/**
+ * @brief Records dropped because the ring was full since tracing started.
+ */
+uint16_t onset_trace_dropped(void);
+
+#endif // ONSET_TRACE_H
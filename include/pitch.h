@@ -0,0 +1,31 @@
+// pitch.h
+// MIDI note numbers and their buzzer frequencies.
+
+#ifndef PITCH_H
+#define PITCH_H
+
+#include "hal.h"
+
+// Number of MIDI notes covered by the pitch table (0..127)
+#define PITCH_NOTE_COUNT  128
+
+/**
+ * @brief Frequency of a MIDI note number.
+ * @param note  MIDI note (60 = C4, 69 = A4); values above 127 are clamped.
+ * @return Frequency in Hz, rounded to the nearest integer.
+ */
+uint16_t pitch_note_to_hz(uint8_t note);
+
+/**
+ * @brief Nearest MIDI note to a frequency.
+ *
+ * Inverse of pitch_note_to_hz() from note 12 up, so frequencies written by
+ * midi_csv_generator map back to their original notes. Below that some
+ * notes share a rounded frequency and the lower one is returned.
+ *
+ * @param hz  Frequency in Hz.
+ * @return MIDI note 0..127.
+ */
+uint8_t pitch_hz_to_note(uint16_t hz);
+
+#endif // PITCH_H
@@ -0,0 +1,85 @@
+// play_clock.h
+// Song-position clock driven by hal_micros() with integer tempo scaling.
+// The position is kept in song microseconds, the unit of NoteEvent times.
+// Elapsed real time is multiplied by the tempo (in percent) and carried as
+// an exact remainder, so the position never drifts. Positions are 32-bit,
+// which covers songs up to 71 minutes.
+//
+// The clock is shared with the note scheduler interrupt; every function
+// here is safe to call from either side.
+
+#ifndef PLAY_CLOCK_H
+#define PLAY_CLOCK_H
+
+#include "hal.h"
+
+// Tempo is a percentage of the song's own speed
+#define PLAY_CLOCK_TEMPO_UNITY  100
+#define PLAY_CLOCK_TEMPO_MIN    10
+#define PLAY_CLOCK_TEMPO_MAX    400
+#define PLAY_CLOCK_TEMPO_STEP   10
+
+// Upper bound returned by play_clock_us_until()
+#define PLAY_CLOCK_MAX_WAIT_US  1000000UL
+
+/**
+ * @brief Stop the clock at song position `us` and reset tempo to unity.
+ */
+void play_clock_reset(uint32_t us);
+
+/**
+ * @brief Start or resume advancing from the current position.
+ */
+void play_clock_resume(void);
+
+/**
+ * @brief Stop advancing; the position is kept.
+ */
+void play_clock_pause(void);
+
+/**
+ * @brief Jump to song position `us` (running state is unchanged).
+ */
+void play_clock_set(uint32_t us);
+
+/**
+ * @brief Advance the position by the real time elapsed since the last call.
+ *
+ * Call at least once per second while running; longer gaps are handled but
+ * cost a few extra iterations.
+ */
+void play_clock_update(void);
+
+/**
+ * @brief Current song position in microseconds (as of the last update).
+ */
+uint32_t play_clock_us(void);
+
+/**
+ * @brief Current song position in whole milliseconds, for display.
+ */
+uint32_t play_clock_ms(void);
+
+/**
+ * @brief Real time until the song position reaches `us` at the current tempo.
+ *
+ * @return Microseconds (rounded up), 0 if already reached, saturating at
+ *         PLAY_CLOCK_MAX_WAIT_US.
+ */
+uint32_t play_clock_us_until(uint32_t us);
+
+/**
+ * @brief Change the playback speed.
+ *
+ * Time elapsed so far is accounted at the old tempo first.
+ *
+ * @param percent  New tempo, clamped to PLAY_CLOCK_TEMPO_MIN..MAX.
+ */
+void play_clock_set_tempo(int16_t percent);
+
+/**
+ * @brief Current tempo in percent (PLAY_CLOCK_TEMPO_UNITY = normal speed).
+ */
+uint16_t play_clock_tempo(void);
+
+#endif // PLAY_CLOCK_H
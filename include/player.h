@@ -1,23 +1,22 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-#include <Arduino.h>
-#include <Tone.h>
+#include "hal.h"        // Tone output, clock and storage abstraction
 #include "sd_card.h"    // Provides NoteEvent struct definition
 
-// Maximum number of simultaneous active note events
-#define MAX_ACTIVE_EVENTS 10
-
-// Number of buzzers (pins) used for polyphonic playback.
-// Must match the length of the buzzerPins array in player.cpp.
+// Number of buzzers (pins) used for polyphonic playback; the first
+// NUM_BUZZERS entries of buzzerPins in player.cpp are used. Songs with
+// unassigned notes (buzzer 0) adapt to any count; override with -D.
+#ifndef NUM_BUZZERS
 #define NUM_BUZZERS       5
+#endif
 
 /**
  * @brief Initialize the playback engine.
  *
- * Sets up Tone objects on each buzzer pin (only once),
- * resets tempo and transpose factors, clears active events,
- * and preloads the first NoteEvent from the open CSV file.
+ * Attaches a HAL tone voice to each buzzer pin (only once),
+ * resets the transpose, clears the voice table,
+ * and fills the event queue from the open song file.
  */
 void player_init(void);
 
@@ -25,18 +24,38 @@ void player_init(void);
  * @brief Drive the playback engine.
  *
  * Should be called repeatedly (e.g., in loop()) with the
- * current playback time (in milliseconds). Starts any
- * new notes whose startTime ≤ currentTime*tempoFactor,
- * and stops notes whose endTime ≤ currentTime*tempoFactor.
+ * current song position (in microseconds, tempo already
+ * applied; see play_clock.h). Starts any new notes whose
+ * startTime ≤ currentTime, and stops notes whose
+ * endTime ≤ currentTime.
  *
- * @param currentTime  Playback time in ms, multiplied by tempoFactor.
+ * @param currentTime  Song position in µs.
  */
 void player_update(unsigned long currentTime);
 
+/**
+ * @brief Song time of the next note start or stop player_update() will act on.
+ *
+ * @param time  Receives the deadline in song µs.
+ * @return false if nothing is queued or sounding.
+ */
+bool player_next_deadline(unsigned long* time);
+
+/**
+ * @brief Read ahead more events from SD into the event queue.
+ *
+ * Call from loop() whenever it has slack; player_update() itself never
+ * touches the SD card, so it can run from the note scheduler interrupt.
+ *
+ * @param maxEvents  Upper bound on events parsed by this call.
+ * @return Number of events queued.
+ */
+uint8_t player_refill(uint8_t maxEvents);
+
 /**
  * @brief Query whether playback has completed.
  *
- * @return true if no future events are loaded and no
+ * @return true if no future events are queued or unread and no
  *         active notes remain sounding.
  */
 bool player_is_idle(void);
@@ -44,7 +63,7 @@ bool player_is_idle(void);
 /**
  * @brief Immediately stop all currently playing notes.
  *
- * Stops each active buzzer and clears the active events list.
+ * Stops each sounding buzzer and clears the voice table.
  * Also re-enables interrupts to allow normal operation.
  */
 void player_stop_all(void);
@@ -52,9 +71,10 @@ void player_stop_all(void);
 /**
  * @brief Adjust the global transpose setting.
  *
- * Modifies the pitch of all subsequently played notes by the
- * given number of semitones. Internally updates a frequency
- * scaling factor = 2^(semitones/12).
+ * Shifts the pitch of sounding and subsequently played notes by
+ * the given number of semitones. The shift is applied to the MIDI
+ * note number ahead of the pitch table lookup; results outside
+ * 0..127 are clamped.
  *
  * @param semitones  Number of semitones to shift (positive or negative).
  */
@@ -63,11 +83,13 @@ void player_modify_transpose(int semitones);
 /**
  * @brief Seek playback to a new time within the current file.
  *
- * Stops all buzzers, reopens the current file, and parses events
- * up to newTime. Any notes that would still be sounding at newTime
- * are started immediately.
+ * Stops all buzzers and reopens the current file. When a seek index is
+ * open (see seek_index.h) playback resumes from the nearest checkpoint,
+ * otherwise from the first event; the remaining events up to newTime are
+ * then parsed. Any notes that would still be sounding at newTime are
+ * started immediately.
  *
- * @param newTime   Target playback time in ms.
+ * @param newTime   Target playback time in µs.
  * @param filename  Name of the CSV file currently open on SD.
  */
 void player_seek(unsigned long newTime, const char* filename);
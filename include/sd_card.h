@@ -1,33 +1,72 @@
 // sd_card.h
-// SD card interface for listing and reading note-event CSV files.
+// SD card interface for listing and reading note-event song files
+// (CSV text or the binary format described in song_format.h).
 
 #ifndef SD_CARD_H
 #define SD_CARD_H
 
-#include <Arduino.h>
-#include <SD.h>
+#include "hal.h"
 
-// Maximum number of CSV files to index on SD card
+// Maximum number of song files to index on SD card
 #define MAX_FILES    12
 // Maximum length of a filename (including null terminator)
 #define MAX_FN_LEN   32
+// Size of the read-ahead buffer the event parser tokenizes from
+#define SD_READ_BUF_SIZE 64
 
 /**
  * @struct NoteEvent
- * @brief Represents a single musical note event loaded from a CSV file.
+ * @brief Represents a single musical note event loaded from a song file.
  *
- * @var frequency   Frequency of the note in Hz
- * @var startTime   Time (ms) when the note should start
- * @var endTime     Time (ms) when the note should end
- * @var buzzer      1-based index of the buzzer to play this note
+ * @var note        MIDI note number (frequencies in CSV and fixed-format
+ *                  songs are mapped to the nearest note, see pitch.h)
+ * @var startTime   Time (µs from song start) when the note should start
+ * @var endTime     Time (µs from song start) when the note should end
+ * @var buzzer      1-based index of the buzzer to play this note, or 0 to
+ *                  let the player allocate one when the note starts
  */
 struct NoteEvent {
-    uint16_t      frequency;
+    uint8_t       note;
     unsigned long startTime;
     unsigned long endTime;
     uint8_t       buzzer;
 };
 
+/**
+ * @struct SdReadStats
+ * @brief Parse cost of the events read from the current file.
+ *
+ * @var events   Number of events successfully parsed
+ * @var totalUs  Total time (µs) spent inside sd_read_next_event() for them
+ * @var maxUs    Slowest single event (µs), typically one that hit an SD block fetch
+ */
+struct SdReadStats {
+    uint32_t events;
+    uint32_t totalUs;
+    uint32_t maxUs;
+};
+
+/**
+ * @struct SongInfo
+ * @brief Metadata of the open song (see song_format.h).
+ *
+ * tickUs is always set. The other fields come from a binary song header
+ * and are 0 when unknown: always for CSV files, and for binary songs
+ * written without the optional header fields.
+ *
+ * @var eventCount    Number of note events in the song
+ * @var duration      End time of the last note, in µs
+ * @var maxPolyphony  Most notes sounding at once
+ * @var tickUs        Microseconds per time tick in the file; NoteEvent
+ *                    times are scaled by it on reading
+ */
+struct SongInfo {
+    uint32_t eventCount;
+    uint32_t duration;
+    uint8_t  maxPolyphony;
+    uint32_t tickUs;
+};
+
 /// @name CSV File I/O Operations
 /// @{
 
@@ -39,25 +78,81 @@ struct NoteEvent {
 bool sd_init(uint8_t csPin);
 
 /**
- * @brief Open a CSV file on the SD card for reading note events.
- * @param filename  Name or path of the CSV file.
- * @return true on successful open, false on failure.
+ * @brief Open a song file on the SD card for reading note events.
+ *
+ * Files starting with SONG_MAGIC are read as binary records (fixed-size
+ * or delta/varint encoded); any other file is parsed as CSV and its
+ * header row is skipped.
+ *
+ * @param filename  Name or path of the CSV or binary song file.
+ * @return true on successful open, false on failure or unsupported format.
  */
 bool sd_open_file(const char* filename);
 
 /**
  * @brief Skip the header row of the currently opened CSV file.
- *        Assumes the first line contains column names.
+ *
+ * Assumes the first line contains column names. Times are taken as µs when
+ * a column name ends in "_us" (start_us, end_us), otherwise as
+ * SONG_TICK_US_DEFAULT (ms).
  */
 void sd_skip_header(void);
 
 /**
- * @brief Read the next NoteEvent from the open CSV file.
+ * @brief Read the next NoteEvent from the open song file.
+ *
+ * CSV lines are tokenized in place, fixed binary records are copied
+ * straight and delta records are decoded incrementally from a fixed
+ * read-ahead buffer; never allocates from the heap.
+ *
  * @param e  Pointer to a NoteEvent struct to populate.
  * @return true if an event was read, false if end of file or error.
  */
 bool sd_read_next_event(NoteEvent* e);
 
+/**
+ * @brief Byte offset of the next event to be returned by sd_read_next_event().
+ * @return Offset suitable for a later sd_seek().
+ */
+uint32_t sd_tell(void);
+
+/**
+ * @brief Decoding base at the current position.
+ *
+ * Delta-encoded songs store each start time relative to the previous event;
+ * this is the start time the next record is relative to. Always 0 for CSV
+ * and fixed-record songs.
+ *
+ * @return Value to pass back to sd_seek() together with sd_tell().
+ */
+uint32_t sd_time_base(void);
+
+/**
+ * @brief Reposition the open song so the next read returns the event at offset.
+ * @param offset    Event boundary obtained from sd_tell() (or a seek index).
+ * @param timeBase  sd_time_base() at that boundary (ignored unless delta).
+ * @return true on success, false if no file is open or the seek failed.
+ */
+bool sd_seek(uint32_t offset, uint32_t timeBase);
+
+/**
+ * @brief Size of the open song in bytes.
+ * @return File size, or 0 if no file is open.
+ */
+uint32_t sd_file_size(void);
+
+/**
+ * @brief Header metadata of the currently open song.
+ * @return Pointer to metadata reset by sd_open_file().
+ */
+const SongInfo* sd_get_song_info(void);
+
+/**
+ * @brief Parse cost statistics for the currently open file.
+ * @return Pointer to counters reset by sd_open_file().
+ */
+const SdReadStats* sd_get_read_stats(void);
+
 /**
  * @brief Check whether all events have been read from the current file.
  * @return true if no more events remain, false otherwise.
@@ -70,14 +165,14 @@ bool sd_finished(void);
 /// @{
 
 /**
- * @brief Scan the root directory of the SD card for .csv files.
+ * @brief Scan the root directory of the SD card for .csv and .bzs files.
  *        Populates an internal list of filenames.
  */
 void sd_list_csv_files(void);
 
 /**
- * @brief Get the number of .csv files found in the last scan.
- * @return Count of CSV files (0..MAX_FILES).
+ * @brief Get the number of song files found in the last scan.
+ * @return Count of song files (0..MAX_FILES).
  */
 uint8_t sd_get_file_count(void);
 
@@ -0,0 +1,53 @@
+// seek_index.h
+// Time → file offset index kept next to each song, used by player_seek().
+
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+
+#include "hal.h"
+#include "sd_card.h"
+#include "song_format.h"
+
+/**
+ * @brief Open the seek index of a song, building it first if needed.
+ *
+ * Looks for the index next to the song (seek_index_name()). If it is missing or was built
+ * from a different version of the song, scans the whole song once and
+ * writes a fresh index. The song must already be open via sd_open_file();
+ * the scan reuses that reader, so the song is reopened at its first event
+ * before returning. The scan also replays the song through the voice table
+ * (voices.h), so call it with the player stopped; player_init() clears
+ * the table afterwards.
+ *
+ * @param songName  Name of the song file on SD.
+ * @return true if an index is open for lookups, false otherwise
+ *         (seeking then falls back to a full rescan).
+ */
+bool seek_index_prepare(const char* songName);
+
+/**
+ * @brief Name of a song's seek index sidecar: the song's base name with
+ *        extension "I" plus the first two letters of the song's
+ *        (SONG.BZS -> SONG.IBZ, see song_format.h).
+ *
+ * @param songName  Name of the song file.
+ * @param out       Receives the name; MAX_FN_LEN bytes.
+ */
+void seek_index_name(const char* songName, char* out);
+
+/**
+ * @brief Close the currently open seek index, if any.
+ */
+void seek_index_close(void);
+
+/**
+ * @brief Fetch the last checkpoint at or before the given time.
+ *
+ * @param time   Target song time.
+ * @param entry  Receives the checkpoint (time, offset and sounding notes).
+ * @return true if a checkpoint was found, false if no index is open or it
+ *         has no entries.
+ */
+bool seek_index_lookup(unsigned long time, IndexEntry* entry);
+
+#endif // SEEK_INDEX_H
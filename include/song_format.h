@@ -0,0 +1,166 @@
+// song_format.h
+// On-card layout of the binary note-event song format (.bzs) and of the
+// seek index sidecar.
+//
+// A binary song starts with a SongHeader followed by records in one of the
+// SONG_FMT_* encodings. All multi-byte fields are little-endian. Files that
+// do not begin with SONG_MAGIC are treated as CSV, so existing CSV libraries
+// keep working.
+
+#ifndef SONG_FORMAT_H
+#define SONG_FORMAT_H
+
+#include <stdint.h>
+
+// File extension used for binary songs
+#define SONG_EXT            ".bzs"
+
+// First four bytes of every binary song
+#define SONG_MAGIC          "BZSG"
+#define SONG_MAGIC_LEN      4
+
+// Current header version
+#define SONG_VERSION        1
+
+// Values of SongHeader::format
+#define SONG_FMT_FIXED      0   // Packed SONG_RECORD_SIZE-byte records
+#define SONG_FMT_DELTA      1   // Variable-length delta/varint records
+
+// Size of one packed fixed-format record:
+//   uint16_t frequency, uint32_t startTime, uint32_t endTime, uint8_t buzzer
+#define SONG_RECORD_SIZE    11
+
+// A delta-format record is, in order:
+//   varint   startDelta   start time minus the previous event's start
+//                         (the first event is relative to 0)
+//   varint   duration     end time minus start time
+//   uint8_t  note         MIDI note number, resolved through pitch.h
+//   uint8_t  buzzer
+// Varints are unsigned LEB128: 7 data bits per byte, least significant
+// group first, high bit set on every byte except the last. Records run to
+// the end of the file; eventCount is informational.
+#define SONG_VARINT_MAX_BYTES  5
+
+// Microseconds per time tick assumed when a song does not declare it
+// (binary headers without tickUs, CSV files without _us column names)
+#define SONG_TICK_US_DEFAULT  1000UL
+
+// Smallest valid header: the fields up to and including eventCount.
+// Fields after it are optional and read as 0 when headerSize stops short.
+#define SONG_HEADER_MIN_SIZE  12
+
+/**
+ * @struct SongHeader
+ * @brief Header at offset 0 of a binary song (24 bytes, packed).
+ *
+ * @var magic         SONG_MAGIC, not null-terminated
+ * @var version       SONG_VERSION the file was written with
+ * @var format        Record encoding (SONG_FMT_*)
+ * @var headerSize    Total header size in bytes; records start at this offset.
+ *                    Readers skip any header bytes they do not understand.
+ * @var eventCount    Number of records following the header
+ * @var duration      End time of the last note, in ticks (0 = unknown)
+ * @var maxPolyphony  Most notes sounding at once (0 = unknown)
+ * @var reserved      Written as 0
+ * @var tickUs        Microseconds per time tick of every time and delta in
+ *                    the records (1 = µs, 1000 = ms; 0 = SONG_TICK_US_DEFAULT)
+ */
+struct __attribute__((packed)) SongHeader {
+    char     magic[SONG_MAGIC_LEN];
+    uint8_t  version;
+    uint8_t  format;
+    uint16_t headerSize;
+    uint32_t eventCount;
+    uint32_t duration;
+    uint8_t  maxPolyphony;
+    uint8_t  reserved[3];
+    uint32_t tickUs;
+};
+
+// -----------------------------------------------------------------------------
+// Seek index sidecar
+//
+// Stored next to the song under the same base name, with an extension made
+// of INDEX_EXT_PREFIX and the first two letters of the song's extension
+// (SONG.CSV -> SONG.ICS, SONG.BZS -> SONG.IBZ; lower case for lower-case
+// extensions). A CSV and a binary copy of a song so keep separate indexes,
+// and the name stays 8.3 as the SD library requires. It holds one IndexEntry
+// per INDEX_INTERVAL of song time, so the entry for time t is found directly
+// at headerSize + (t / interval) * sizeof(IndexEntry).
+// -----------------------------------------------------------------------------
+
+// First letter of the seek index sidecar's extension
+#define INDEX_EXT_PREFIX    'I'
+
+// First four bytes of every seek index
+#define INDEX_MAGIC         "BZIX"
+
+// Current index version
+#define INDEX_VERSION       6
+
+// Song time between checkpoints, in µs like every time stored in the index
+// (NoteEvent times, after scaling by the song's tick)
+#define INDEX_INTERVAL      2000000UL
+
+// Voice slots per checkpoint, one per buzzer; NUM_BUZZERS must not exceed it
+#define INDEX_MAX_VOICES    8
+
+/**
+ * @struct IndexHeader
+ * @brief Header at offset 0 of a seek index (20 bytes, packed).
+ *
+ * @var magic       INDEX_MAGIC, not null-terminated
+ * @var version     INDEX_VERSION the file was written with
+ * @var buzzers     NUM_BUZZERS the voices were allocated for; an index
+ *                  built for another count is rebuilt
+ * @var headerSize  Offset of the first IndexEntry
+ * @var interval    Song time between consecutive entries
+ * @var songSize    Size in bytes of the song the index was built from;
+ *                  a mismatch marks the index as stale
+ * @var entryCount  Number of entries
+ */
+struct __attribute__((packed)) IndexHeader {
+    char     magic[SONG_MAGIC_LEN];
+    uint8_t  version;
+    uint8_t  buzzers;
+    uint16_t headerSize;
+    uint32_t interval;
+    uint32_t songSize;
+    uint32_t entryCount;
+};
+
+/**
+ * @struct IndexVoice
+ * @brief The note a buzzer is playing at a checkpoint (9 bytes, packed),
+ *        as voices_start() recorded it. endTime 0 = buzzer silent.
+ */
+struct __attribute__((packed)) IndexVoice {
+    uint8_t  note;       // MIDI note number, as NoteEvent.note
+    uint32_t startTime;  // Kept for voices_allocate()'s duration ranking
+    uint32_t endTime;
+};
+
+/**
+ * @struct IndexEntry
+ * @brief Checkpoint at time = entry number * interval (84 bytes, packed).
+ *
+ * @var time      Checkpoint time; every event starting at or before it lies
+ *                before offset
+ * @var offset    Byte offset in the song of the first event starting after time
+ * @var baseTime  Start time of the event just before offset, which delta
+ *                records at offset are relative to (0 for other formats).
+ *                In song ticks, as stored in the delta stream.
+ * @var voices  The voice table (voices.h) player_update() would hold at
+ *              time: voices[n-1] is what buzzer n is playing. Unassigned
+ *              notes sit where voices_allocate() put them for the header's
+ *              buzzer count, and preempted or replaced notes are gone.
+ *              Slots past that count are unused.
+ */
+struct __attribute__((packed)) IndexEntry {
+    uint32_t   time;
+    uint32_t   offset;
+    uint32_t   baseTime;
+    IndexVoice voices[INDEX_MAX_VOICES];
+};
+
+#endif // SONG_FORMAT_H
@@ -0,0 +1,66 @@
+// tone_dds.h
+// Alternative tone engine: one fixed-rate timer interrupt (timer1 compare
+// A) drives every buzzer. Each voice has a 16-bit phase accumulator that
+// advances by a per-note increment on every tick; the pin toggles whenever
+// the top bit of the accumulator flips. Voices sharing a GPIO port (the
+// Mega's buzzers sit on ports A and C) are toggled together by one store
+// to the port's PINx register. The Tone library needs one
+// hardware timer per voice; this engine needs one timer in total, at the
+// cost of period jitter of up to one tick (50 µs at the default rate).
+//
+// Built instead of the Tone backend when HAL_TONE_DDS is defined (see the
+// *_dds environments in platformio.ini); hal_arduino.cpp then routes
+// hal_tone_*() here, so player.cpp is unchanged.
+
+#ifndef TONE_DDS_H
+#define TONE_DDS_H
+
+#include "hal.h"
+
+// Tick rate of the accumulator interrupt (Hz). Notes above half this rate
+// alias, so the top of the MIDI range is clamped.
+#ifndef TONE_DDS_RATE
+#define TONE_DDS_RATE    20000UL
+#endif
+
+// Voices the interrupt services
+#ifndef TONE_DDS_VOICES
+#define TONE_DDS_VOICES  HAL_MAX_VOICES
+#endif
+
+// 1: voices on the same port are toggled together with one PINx store per
+// tick; 0: one store per toggling voice (to compare in the load dump)
+#ifndef TONE_DDS_BATCH
+#define TONE_DDS_BATCH   1
+#endif
+
+/**
+ * @brief Attach a voice to a pin (driven low) and start the tick timer.
+ */
+void tone_dds_begin(uint8_t voice, uint8_t pin);
+
+/**
+ * @brief Start or retune a voice at a frequency in Hz (divides at run time).
+ */
+void tone_dds_play(uint8_t voice, uint16_t frequency);
+
+/**
+ * @brief Start or retune a voice on a MIDI note (increment from a table).
+ */
+void tone_dds_play_note(uint8_t voice, uint8_t note);
+
+/**
+ * @brief Silence a voice and drive its pin low.
+ */
+void tone_dds_stop(uint8_t voice);
+
+/**
+ * @brief Print the interrupt's measured CPU load per number of sounding
+ *        voices on the console, then clear the measurements.
+ *
+ * Only measured when built with TONE_DDS_PROFILE; the measurement itself
+ * is included in the reported cycles.
+ */
+void tone_dds_dump_load(void);
+
+#endif // TONE_DDS_H
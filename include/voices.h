@@ -0,0 +1,106 @@
+// voices.h
+// Table of sounding notes, one slot per buzzer, plus a min-heap of the
+// busy slots ordered by end time. Starting a note on a busy buzzer replaces
+// its entry in place, so the previous note can never silence the new one,
+// and finding or removing the next note to stop is O(1) / O(log n).
+// Notes that do not name a buzzer get one from voices_allocate(), which
+// preempts the least valuable sounding note when all are busy.
+// The table only does bookkeeping; the player drives the HAL tone outputs.
+
+#ifndef VOICES_H
+#define VOICES_H
+
+#include "hal.h"
+
+// Number of slots (one per HAL tone voice)
+#define VOICE_COUNT  HAL_MAX_VOICES
+
+// Returned by voices_pop_expired() when no note has ended
+#define VOICE_NONE   0xFF
+
+// Preemption ranking of voices_allocate(), as in midi_csv_generator/main.py:
+// a note is worth keeping the shorter it is relative to the longest sounding
+// note, and the closer it is to the middle pitch. Weights are relative.
+#define VOICE_KEEP_W_DUR   4
+#define VOICE_KEEP_W_PITCH 1
+#define VOICE_MID_PITCH    66
+
+/**
+ * @brief Forget all sounding notes.
+ */
+void voices_reset(void);
+
+/**
+ * @brief Record that a note is sounding on a voice from startTime until
+ *        endTime.
+ *
+ * A note already sounding on the voice is replaced (re-trigger).
+ *
+ * @param voice      Slot 0..VOICE_COUNT-1 (buzzer number - 1)
+ * @param startTime  Song time the note started
+ * @param endTime    Time at which the note must be stopped
+ * @param note       MIDI note as written in the song (before transpose)
+ */
+void voices_start(uint8_t voice, unsigned long startTime, unsigned long endTime,
+                  uint8_t note);
+
+/**
+ * @brief Choose the voice for a note that starts at startTime and has no
+ *        buzzer of its own.
+ *
+ * The lowest-numbered voice that is silent, or whose note has ended by
+ * startTime, is taken first. If all are busy, the note with the lowest keep
+ * score (VOICE_KEEP_W_*) is preempted; the caller starts the new note over
+ * it. Scans at most count voices, without division or allocation, so it can
+ * run from the note scheduler interrupt.
+ *
+ * @param count      Voices available, 1..VOICE_COUNT (the number of buzzers)
+ * @param startTime  Start time of the new note
+ * @return Voice to play the note on.
+ */
+uint8_t voices_allocate(uint8_t count, unsigned long startTime);
+
+/**
+ * @brief Number of busy voices voices_allocate() has preempted since the
+ *        last voices_reset().
+ */
+uint16_t voices_preempted(void);
+
+/**
+ * @brief Remove the earliest-ending note if it has ended by now.
+ *
+ * Call repeatedly until it returns VOICE_NONE to collect every note due.
+ *
+ * @return Voice whose note ended (now free), or VOICE_NONE.
+ */
+uint8_t voices_pop_expired(unsigned long now);
+
+/**
+ * @brief End time of the earliest-ending sounding note.
+ * @return false if no note is sounding.
+ */
+bool voices_next_end(unsigned long* endTime);
+
+/**
+ * @brief Whether a note is sounding on a voice.
+ */
+bool voices_busy(uint8_t voice);
+
+/**
+ * @brief Song note sounding on a busy voice, as passed to voices_start().
+ */
+uint8_t voices_note(uint8_t voice);
+
+/**
+ * @brief Start and end time of the note on a busy voice, as passed to
+ *        voices_start().
+ */
+unsigned long voices_start_time(uint8_t voice);
+unsigned long voices_end_time(uint8_t voice);
+
+/**
+ * @brief Number of notes currently sounding.
+ */
+uint8_t voices_active(void);
+
+#endif // VOICES_H
@@ -63,30 +63,49 @@
 //  > 0 - duration specified
 //  = 0 - stopped
 //  < 0 - infinitely (until stop() method called, or new play() called)
+//
+// timerx_retune_cs / timerx_retune_ocr:
+//  a new pitch from setFrequency() / setMidiNote(), applied by the compare
+//  interrupt right after the counter clears (cs = 0 - nothing pending).
+//  In CTC mode OCRnA is not double-buffered: writing a value below the
+//  running count makes the timer run on to its top and wrap, which is
+//  heard as a click.
 
 #if !defined(__AVR_ATmega8__)
 volatile int32_t timer0_toggle_count;
 volatile uint8_t *timer0_pin_port;
 volatile uint8_t timer0_pin_mask;
+volatile uint8_t timer0_retune_cs;
+volatile uint16_t timer0_retune_ocr;
 #endif
 
 volatile int32_t timer1_toggle_count;
 volatile uint8_t *timer1_pin_port;
 volatile uint8_t timer1_pin_mask;
+volatile uint8_t timer1_retune_cs;
+volatile uint16_t timer1_retune_ocr;
 volatile int32_t timer2_toggle_count;
 volatile uint8_t *timer2_pin_port;
 volatile uint8_t timer2_pin_mask;
+volatile uint8_t timer2_retune_cs;
+volatile uint16_t timer2_retune_ocr;
 
 #if defined(__AVR_ATmega2560__)
 volatile int32_t timer3_toggle_count;
 volatile uint8_t *timer3_pin_port;
 volatile uint8_t timer3_pin_mask;
+volatile uint8_t timer3_retune_cs;
+volatile uint16_t timer3_retune_ocr;
 volatile int32_t timer4_toggle_count;
 volatile uint8_t *timer4_pin_port;
 volatile uint8_t timer4_pin_mask;
+volatile uint8_t timer4_retune_cs;
+volatile uint16_t timer4_retune_ocr;
 volatile int32_t timer5_toggle_count;
 volatile uint8_t *timer5_pin_port;
 volatile uint8_t timer5_pin_mask;
+volatile uint8_t timer5_retune_cs;
+volatile uint16_t timer5_retune_ocr;
 #endif
 
 
@@ -97,12 +116,18 @@ volatile uint8_t timer5_pin_mask;
 // Leave timers 1, and zero to last.
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2, 3, 4, 5, 1, 0 };
 
+// Output compare A pin of each timer, indexed by timer number
+const uint8_t PROGMEM tone_timer_to_oca_pin_PGM[] = { 13, 11, 10, 5, 6, 46 };
+
 #elif defined(__AVR_ATmega8__)
 
 #define AVAILABLE_TONE_PINS 2
 
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2, 1 };
 
+// Timer 0 has no compare output on the ATmega8
+const uint8_t PROGMEM tone_timer_to_oca_pin_PGM[] = { 0xff, 9, 11 };
+
 #else
 
 #define AVAILABLE_TONE_PINS 3
@@ -110,9 +135,162 @@ const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2, 1 };
 // Leave timer 0 to last.
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2, 1, 0 };
 
+const uint8_t PROGMEM tone_timer_to_oca_pin_PGM[] = { 6, 9, 11 };
+
+#endif
+
+
+// Interrupt profiling (see Tone.h)
+//
+// The cycles of a call are read from the interrupt's own timer at its end:
+// in CTC mode the counter restarted at the compare match, so its count
+// times the prescalar covers interrupt entry and the body, but not the
+// register restore on exit. Low notes on a large prescalar are measured
+// in coarse steps.
+
+#ifdef TONE_ISR_PROFILE
+
+#ifdef WIRING
+#error "TONE_ISR_PROFILE needs the Arduino core's millis() timer"
+#endif
+
+#if (TONE_PROFILE_SLOTS & (TONE_PROFILE_SLOTS - 1)) != 0
+#error "TONE_PROFILE_SLOTS must be a power of two"
+#endif
+
+#if defined(__AVR_ATmega2560__)
+#define TONE_PROFILE_TIMERS 6
+#else
+#define TONE_PROFILE_TIMERS 3
+#endif
+
+// Arduino core (wiring.c): timer0 overflows since reset, one per 2^14 cycles
+extern volatile unsigned long timer0_overflow_count;
+
+struct tone_profile_slot
+{
+  uint16_t epoch;     // timer0_overflow_count >> TONE_PROFILE_SLOT_SHIFT
+  uint16_t calls;
+  uint32_t cycles;
+};
+
+static tone_profile_slot tone_profile[TONE_PROFILE_TIMERS][TONE_PROFILE_SLOTS];
+
+// log2 of the prescalar selected by the CSn2:0 bits
+const uint8_t PROGMEM tone_cs_shift_PGM[8] = { 0, 0, 3, 6, 8, 10, 0, 0 };         // timer0, 16 bit
+const uint8_t PROGMEM tone_cs_shift_timer2_PGM[8] = { 0, 0, 3, 5, 6, 7, 8, 10 };
+
+// Interrupts are off in the handlers, so the overflow count is read whole.
+// A slot left from an earlier epoch is restarted.
+
+static inline void tone_profile_add(uint8_t timer, uint16_t ticks, uint8_t shift)
+{
+  uint16_t epoch = timer0_overflow_count >> TONE_PROFILE_SLOT_SHIFT;
+  tone_profile_slot *slot = &tone_profile[timer][epoch & (TONE_PROFILE_SLOTS - 1)];
+
+  if (slot->epoch != epoch)
+  {
+    slot->epoch = epoch;
+    slot->calls = 0;
+    slot->cycles = 0;
+  }
+  slot->calls++;
+  slot->cycles += (uint32_t)ticks << shift;
+}
+
+#define TONE_PROFILE_END(n, shifts) \
+  tone_profile_add(n, TCNT##n, pgm_read_byte(shifts + (TCCR##n##B & 0b111)))
+
+#else
+
+#define TONE_PROFILE_END(n, shifts)
+
 #endif
 
 
+// MIDI note to timer settings
+//
+// Note-on by MIDI number is a table lookup instead of the divisions in
+// play(). The tables are evaluated by the compiler for the build's F_CPU
+// and kept in flash: one per prescaler set (timer0, timer2, 16 bit).
+// Each entry holds the compare value and the CSn2:0 prescaler bits.
+// Notes below the range of an 8 bit timer (about 30 Hz, B0) are clamped
+// to its lowest pitch.
+
+#define TONE_MIDI_NOTES 128
+
+struct tone_setting
+{
+  uint16_t ocr;
+  uint8_t prescalarbits;
+};
+
+// Equal-tempered frequencies of MIDI notes 0..11 (C-1..B-1) in mHz;
+// each octave up halves the period
+constexpr uint16_t tone_octave_mhz[12] =
+{
+  8176, 8662, 9177, 9723, 10301, 10913, 11562, 12250, 12978, 13750, 14568, 15434
+};
+
+// Half period of a note in CPU cycles, 12 fractional bits
+constexpr uint64_t tone_half_period(uint8_t note)
+{
+  return ((uint64_t)F_CPU * 1000 * 4096 / (2 * tone_octave_mhz[note % 12])) >> (note / 12);
+}
+
+// Compare value for a prescaler, rounded to the nearest tick
+constexpr uint32_t tone_ocr(uint8_t note, uint16_t prescalar)
+{
+  return (uint32_t)((tone_half_period(note) + ((uint64_t)prescalar << 11)) / ((uint64_t)prescalar << 12)) - 1;
+}
+
+// 8 bit timers: the smallest prescaler that fits, as play() picks it.
+// The prescaler bits are the list position + 1 on both timer0 and timer2.
+constexpr tone_setting tone_setting_8bit(uint8_t note, const uint16_t *prescalars, uint8_t count, uint8_t i)
+{
+  return (tone_ocr(note, prescalars[i]) <= 255)
+    ? tone_setting { (uint16_t)tone_ocr(note, prescalars[i]), (uint8_t)(i + 1) }
+    : (i + 1 == count)
+      ? tone_setting { 255, (uint8_t)(i + 1) }
+      : tone_setting_8bit(note, prescalars, count, i + 1);
+}
+
+constexpr uint16_t tone_prescalars_timer0[] = { 1, 8, 64, 256, 1024 };
+constexpr uint16_t tone_prescalars_timer2[] = { 1, 8, 32, 64, 128, 256, 1024 };
+
+constexpr tone_setting tone_setting_timer0(uint8_t note)
+{
+  return tone_setting_8bit(note, tone_prescalars_timer0, 5, 0);
+}
+
+constexpr tone_setting tone_setting_timer2(uint8_t note)
+{
+  return tone_setting_8bit(note, tone_prescalars_timer2, 7, 0);
+}
+
+// 16 bit timers: ck/1 or ck/64
+constexpr tone_setting tone_setting_timer16(uint8_t note)
+{
+  return (tone_ocr(note, 1) <= 0xffff)
+    ? tone_setting { (uint16_t)tone_ocr(note, 1), 0b001 }
+    : tone_setting { (uint16_t)tone_ocr(note, 64), 0b011 };
+}
+
+#define TONE_NOTES_8(f, n) \
+  f(n), f(n + 1), f(n + 2), f(n + 3), f(n + 4), f(n + 5), f(n + 6), f(n + 7)
+#define TONE_NOTES_128(f) \
+  TONE_NOTES_8(f, 0),   TONE_NOTES_8(f, 8),   TONE_NOTES_8(f, 16),  TONE_NOTES_8(f, 24),  \
+  TONE_NOTES_8(f, 32),  TONE_NOTES_8(f, 40),  TONE_NOTES_8(f, 48),  TONE_NOTES_8(f, 56),  \
+  TONE_NOTES_8(f, 64),  TONE_NOTES_8(f, 72),  TONE_NOTES_8(f, 80),  TONE_NOTES_8(f, 88),  \
+  TONE_NOTES_8(f, 96),  TONE_NOTES_8(f, 104), TONE_NOTES_8(f, 112), TONE_NOTES_8(f, 120)
+
+#if !defined(__AVR_ATmega8__)
+const tone_setting PROGMEM tone_note_timer0_PGM[TONE_MIDI_NOTES] = { TONE_NOTES_128(tone_setting_timer0) };
+#endif
+const tone_setting PROGMEM tone_note_timer2_PGM[TONE_MIDI_NOTES] = { TONE_NOTES_128(tone_setting_timer2) };
+const tone_setting PROGMEM tone_note_timer16_PGM[TONE_MIDI_NOTES] = { TONE_NOTES_128(tone_setting_timer16) };
+
+
 // Initialize our pin count
 
 uint8_t Tone::_tone_pin_count = 0;
@@ -126,6 +304,21 @@ void Tone_Timer0_Interrupt(void)
 ISR(TIMER0_COMPA_vect)
 #endif
 {
+  if (timer0_retune_cs)
+  {
+    // the counter has just cleared: no compare value can be passed over
+    OCR0A = timer0_retune_ocr;
+    TCCR0B = (TCCR0B & 0b11111000) | timer0_retune_cs;
+    timer0_retune_cs = 0;
+
+    if (TCCR0A & (1 << COM0A0))
+    {
+      TIMSK0 &= ~(1 << OCIE0A);    // the compare output toggles the pin
+      TONE_PROFILE_END(0, tone_cs_shift_PGM);
+      return;
+    }
+  }
+
   if (timer0_toggle_count != 0)
   {
     // toggle the pin
@@ -139,6 +332,8 @@ ISR(TIMER0_COMPA_vect)
     TIMSK0 &= ~(1 << OCIE0A);                 // disable the interrupt
     *timer0_pin_port &= ~(timer0_pin_mask);   // keep pin low after stop
   }
+
+  TONE_PROFILE_END(0, tone_cs_shift_PGM);
 }
 #endif
 
@@ -149,6 +344,21 @@ void Tone_Timer1_Interrupt(void)
 ISR(TIMER1_COMPA_vect)
 #endif
 {
+  if (timer1_retune_cs)
+  {
+    // the counter has just cleared: no compare value can be passed over
+    OCR1A = timer1_retune_ocr;
+    TCCR1B = (TCCR1B & 0b11111000) | timer1_retune_cs;
+    timer1_retune_cs = 0;
+
+    if (TCCR1A & (1 << COM1A0))
+    {
+      TIMSK1 &= ~(1 << OCIE1A);    // the compare output toggles the pin
+      TONE_PROFILE_END(1, tone_cs_shift_PGM);
+      return;
+    }
+  }
+
   if (timer1_toggle_count != 0)
   {
     // toggle the pin
@@ -162,6 +372,8 @@ ISR(TIMER1_COMPA_vect)
     TIMSK1 &= ~(1 << OCIE1A);                 // disable the interrupt
     *timer1_pin_port &= ~(timer1_pin_mask);   // keep pin low after stop
   }
+
+  TONE_PROFILE_END(1, tone_cs_shift_PGM);
 }
 
 
@@ -171,6 +383,21 @@ void Tone_Timer2_Interrupt(void)
 ISR(TIMER2_COMPA_vect)
 #endif
 {
+  if (timer2_retune_cs)
+  {
+    // the counter has just cleared: no compare value can be passed over
+    OCR2A = timer2_retune_ocr;
+    TCCR2B = (TCCR2B & 0b11111000) | timer2_retune_cs;
+    timer2_retune_cs = 0;
+
+    if (TCCR2A & (1 << COM2A0))
+    {
+      TIMSK2 &= ~(1 << OCIE2A);    // the compare output toggles the pin
+      TONE_PROFILE_END(2, tone_cs_shift_timer2_PGM);
+      return;
+    }
+  }
+
   int32_t temp_toggle_count = timer2_toggle_count;
 
   if (temp_toggle_count != 0)
@@ -188,6 +415,8 @@ ISR(TIMER2_COMPA_vect)
   }
   
   timer2_toggle_count = temp_toggle_count;
+
+  TONE_PROFILE_END(2, tone_cs_shift_timer2_PGM);
 }
 
 
@@ -200,6 +429,21 @@ void Tone_Timer3_Interrupt(void)
 ISR(TIMER3_COMPA_vect)
 #endif
 {
+  if (timer3_retune_cs)
+  {
+    // the counter has just cleared: no compare value can be passed over
+    OCR3A = timer3_retune_ocr;
+    TCCR3B = (TCCR3B & 0b11111000) | timer3_retune_cs;
+    timer3_retune_cs = 0;
+
+    if (TCCR3A & (1 << COM3A0))
+    {
+      TIMSK3 &= ~(1 << OCIE3A);    // the compare output toggles the pin
+      TONE_PROFILE_END(3, tone_cs_shift_PGM);
+      return;
+    }
+  }
+
   if (timer3_toggle_count != 0)
   {
     // toggle the pin
@@ -213,6 +457,8 @@ ISR(TIMER3_COMPA_vect)
     TIMSK3 &= ~(1 << OCIE3A);                 // disable the interrupt
     *timer3_pin_port &= ~(timer3_pin_mask);   // keep pin low after stop
   }
+
+  TONE_PROFILE_END(3, tone_cs_shift_PGM);
 }
 
 #ifdef WIRING
@@ -221,6 +467,21 @@ void Tone_Timer4_Interrupt(void)
 ISR(TIMER4_COMPA_vect)
 #endif
 {
+  if (timer4_retune_cs)
+  {
+    // the counter has just cleared: no compare value can be passed over
+    OCR4A = timer4_retune_ocr;
+    TCCR4B = (TCCR4B & 0b11111000) | timer4_retune_cs;
+    timer4_retune_cs = 0;
+
+    if (TCCR4A & (1 << COM4A0))
+    {
+      TIMSK4 &= ~(1 << OCIE4A);    // the compare output toggles the pin
+      TONE_PROFILE_END(4, tone_cs_shift_PGM);
+      return;
+    }
+  }
+
   if (timer4_toggle_count != 0)
   {
     // toggle the pin
@@ -234,6 +495,8 @@ ISR(TIMER4_COMPA_vect)
     TIMSK4 &= ~(1 << OCIE4A);                 // disable the interrupt
     *timer4_pin_port &= ~(timer4_pin_mask);   // keep pin low after stop
   }
+
+  TONE_PROFILE_END(4, tone_cs_shift_PGM);
 }
 
 #ifdef WIRING
@@ -242,6 +505,21 @@ void Tone_Timer5_Interrupt(void)
 ISR(TIMER5_COMPA_vect)
 #endif
 {
+  if (timer5_retune_cs)
+  {
+    // the counter has just cleared: no compare value can be passed over
+    OCR5A = timer5_retune_ocr;
+    TCCR5B = (TCCR5B & 0b11111000) | timer5_retune_cs;
+    timer5_retune_cs = 0;
+
+    if (TCCR5A & (1 << COM5A0))
+    {
+      TIMSK5 &= ~(1 << OCIE5A);    // the compare output toggles the pin
+      TONE_PROFILE_END(5, tone_cs_shift_PGM);
+      return;
+    }
+  }
+
   if (timer5_toggle_count != 0)
   {
     // toggle the pin
@@ -255,6 +533,8 @@ ISR(TIMER5_COMPA_vect)
     TIMSK5 &= ~(1 << OCIE5A);                 // disable the interrupt
     *timer5_pin_port &= ~(timer5_pin_mask);   // keep pin low after stop
   }
+
+  TONE_PROFILE_END(5, tone_cs_shift_PGM);
 }
 
 #endif
@@ -268,6 +548,12 @@ void Tone::begin(uint8_t tonePin)
     _timer = pgm_read_byte(tone_pin_to_timer_PGM + _tone_pin_count);
     _tone_pin_count++;
 
+    // On the timer's own OCnA pin, sustained tones toggle in hardware
+    _hw_toggle = (_pin == pgm_read_byte(tone_timer_to_oca_pin_PGM + _timer));
+
+    // playMidiNote() relies on the pin already being an output
+    pinMode(_pin, OUTPUT);
+
     // Set timer specific stuff
     // All timers in CTC mode
     // 8 bit timers will require changing prescalar values,
@@ -363,92 +649,103 @@ void Tone::begin(uint8_t tonePin)
 
 
 
-// frequency (in hertz) and duration (in milliseconds).
+// Prescalar bits and OCR for a frequency (in hertz) on a timer.
 
-void Tone::play(uint16_t frequency, uint32_t duration)
+static uint8_t tone_frequency_setting(int8_t timer, uint16_t frequency, uint32_t *ocr_out)
 {
   uint8_t prescalarbits = 0b001;
-  int32_t toggle_count = 0;
   uint32_t ocr = 0;
 
-  if (_timer >= 0)
+  // if we are using an 8 bit timer, scan through prescalars to find the best fit
+  if (timer == 0 || timer == 2)
   {
-    // Set the pinMode as OUTPUT
-    pinMode(_pin, OUTPUT);
-    
-    // if we are using an 8 bit timer, scan through prescalars to find the best fit
-    if (_timer == 0 || _timer == 2)
+    ocr = F_CPU / frequency / 2 - 1;
+    prescalarbits = 0b001;  // ck/1: same for both timers
+    if (ocr > 255)
     {
-      ocr = F_CPU / frequency / 2 - 1;
-      prescalarbits = 0b001;  // ck/1: same for both timers
+      ocr = F_CPU / frequency / 2 / 8 - 1;
+      prescalarbits = 0b010;  // ck/8: same for both timers
+
+      if (timer == 2 && ocr > 255)
+      {
+        ocr = F_CPU / frequency / 2 / 32 - 1;
+        prescalarbits = 0b011;
+      }
+
       if (ocr > 255)
       {
-        ocr = F_CPU / frequency / 2 / 8 - 1;
-        prescalarbits = 0b010;  // ck/8: same for both timers
+        ocr = F_CPU / frequency / 2 / 64 - 1;
+        prescalarbits = timer == 0 ? 0b011 : 0b100;
 
-        if (_timer == 2 && ocr > 255)
+        if (timer == 2 && ocr > 255)
         {
-          ocr = F_CPU / frequency / 2 / 32 - 1;
-          prescalarbits = 0b011;
+          ocr = F_CPU / frequency / 2 / 128 - 1;
+          prescalarbits = 0b101;
         }
 
         if (ocr > 255)
         {
-          ocr = F_CPU / frequency / 2 / 64 - 1;
-          prescalarbits = _timer == 0 ? 0b011 : 0b100;
-
-          if (_timer == 2 && ocr > 255)
-          {
-            ocr = F_CPU / frequency / 2 / 128 - 1;
-            prescalarbits = 0b101;
-          }
-
+          ocr = F_CPU / frequency / 2 / 256 - 1;
+          prescalarbits = timer == 0 ? 0b100 : 0b110;
           if (ocr > 255)
           {
-            ocr = F_CPU / frequency / 2 / 256 - 1;
-            prescalarbits = _timer == 0 ? 0b100 : 0b110;
-            if (ocr > 255)
-            {
-              // can't do any better than /1024
-              ocr = F_CPU / frequency / 2 / 1024 - 1;
-              prescalarbits = _timer == 0 ? 0b101 : 0b111;
-            }
+            // can't do any better than /1024
+            ocr = F_CPU / frequency / 2 / 1024 - 1;
+            prescalarbits = timer == 0 ? 0b101 : 0b111;
           }
         }
       }
-
-#if !defined(__AVR_ATmega8__)
-      if (_timer == 0)
-        TCCR0B = (TCCR0B & 0b11111000) | prescalarbits;
-      else
-#endif
-        TCCR2B = (TCCR2B & 0b11111000) | prescalarbits;
     }
-    else
+  }
+  else
+  {
+    // two choices for the 16 bit timers: ck/1 or ck/64
+    ocr = F_CPU / frequency / 2 - 1;
+
+    prescalarbits = 0b001;
+    if (ocr > 0xffff)
     {
-      // two choices for the 16 bit timers: ck/1 or ck/64
-      ocr = F_CPU / frequency / 2 - 1;
+      ocr = F_CPU / frequency / 2 / 64 - 1;
+      prescalarbits = 0b011;
+    }
+  }
 
-      prescalarbits = 0b001;
-      if (ocr > 0xffff)
-      {
-        ocr = F_CPU / frequency / 2 / 64 - 1;
-        prescalarbits = 0b011;
-      }
+  *ocr_out = ocr;
+  return prescalarbits;
+}
 
-      if (_timer == 1)
-        TCCR1B = (TCCR1B & 0b11111000) | prescalarbits;
-#if defined(__AVR_ATmega2560__)
-      else if (_timer == 3)
-        TCCR3B = (TCCR3B & 0b11111000) | prescalarbits;
-      else if (_timer == 4)
-        TCCR4B = (TCCR4B & 0b11111000) | prescalarbits;
-      else if (_timer == 5)
-        TCCR5B = (TCCR5B & 0b11111000) | prescalarbits;
+
+// Timer settings of a MIDI note on a timer; notes above 127 are clamped.
+
+static const tone_setting *tone_note_setting(int8_t timer, uint8_t note)
+{
+  if (note >= TONE_MIDI_NOTES)
+    note = TONE_MIDI_NOTES - 1;
+
+#if !defined(__AVR_ATmega8__)
+  if (timer == 0)
+    return tone_note_timer0_PGM + note;
 #endif
+  if (timer == 2)
+    return tone_note_timer2_PGM + note;
+  return tone_note_timer16_PGM + note;
+}
 
-    }
-    
+
+// frequency (in hertz) and duration (in milliseconds).
+
+void Tone::play(uint16_t frequency, uint32_t duration)
+{
+  uint8_t prescalarbits = 0b001;
+  int32_t toggle_count = 0;
+  uint32_t ocr = 0;
+
+  if (_timer >= 0)
+  {
+    // Set the pinMode as OUTPUT
+    pinMode(_pin, OUTPUT);
+
+    prescalarbits = tone_frequency_setting(_timer, frequency, &ocr);
 
     // Calculate the toggle count
     if (duration > 0)
@@ -460,50 +757,188 @@ void Tone::play(uint16_t frequency, uint32_t duration)
       toggle_count = -1;
     }
 
-    // Set the OCR for the given timer,
-    // set the toggle count,
-    // then turn on the interrupts
-    switch (_timer)
-    {
+    _start(prescalarbits, ocr, toggle_count);
+  }
+}
+
 
+// MIDI note number (60 = C4, 69 = A4), played until stop().
+// Same output as play() with the note's frequency, but the timer settings
+// come from a table; notes above 127 are clamped.
+
+void Tone::playMidiNote(uint8_t note)
+{
+  const tone_setting *setting;
+
+  if (_timer >= 0)
+  {
+    setting = tone_note_setting(_timer, note);
+    _start(pgm_read_byte(&setting->prescalarbits), pgm_read_word(&setting->ocr), -1);
+  }
+}
+
+
+// Change the pitch of a sounding tone, e.g. for legato or back-to-back
+// notes on one pin. The new compare value and prescalar are handed to the
+// timer's interrupt, which loads them just after the next compare match,
+// so the current half period finishes and the waveform stays continuous.
+// A timed tone keeps its remaining toggle count. When nothing is playing,
+// these are the same as play(frequency) / playMidiNote(note).
+
+void Tone::setFrequency(uint16_t frequency)
+{
+  uint32_t ocr;
+
+  if (_timer >= 0)
+  {
+    uint8_t prescalarbits = tone_frequency_setting(_timer, frequency, &ocr);
+    _retune(prescalarbits, ocr);
+  }
+}
+
+
+void Tone::setMidiNote(uint8_t note)
+{
+  const tone_setting *setting;
+
+  if (_timer >= 0)
+  {
+    setting = tone_note_setting(_timer, note);
+    _retune(pgm_read_byte(&setting->prescalarbits), pgm_read_word(&setting->ocr));
+  }
+}
+
+
+// Stage new settings for the compare interrupt and make sure it runs once.
+// The pending flag (retune_cs) is cleared while the values are written, so
+// the interrupt never loads half of an update.
+
+void Tone::_retune(uint8_t prescalarbits, uint16_t ocr)
+{
+  if (!isPlaying())
+  {
+    _start(prescalarbits, ocr, -1);
+    return;
+  }
+
+  switch (_timer)
+  {
 #if !defined(__AVR_ATmega8__)
-      case 0:
-        OCR0A = ocr;
-        timer0_toggle_count = toggle_count;
-        bitWrite(TIMSK0, OCIE0A, 1);
-        break;
+    case 0:
+      timer0_retune_cs = 0;
+      timer0_retune_ocr = ocr;
+      timer0_retune_cs = prescalarbits;
+      TIMSK0 |= (1 << OCIE0A);
+      break;
 #endif
 
-      case 1:
-        OCR1A = ocr;
-        timer1_toggle_count = toggle_count;
-        bitWrite(TIMSK1, OCIE1A, 1);
-        break;
-      case 2:
-        OCR2A = ocr;
-        timer2_toggle_count = toggle_count;
-        bitWrite(TIMSK2, OCIE2A, 1);
-        break;
+    case 1:
+      timer1_retune_cs = 0;
+      timer1_retune_ocr = ocr;
+      timer1_retune_cs = prescalarbits;
+      TIMSK1 |= (1 << OCIE1A);
+      break;
+    case 2:
+      timer2_retune_cs = 0;
+      timer2_retune_ocr = ocr;
+      timer2_retune_cs = prescalarbits;
+      TIMSK2 |= (1 << OCIE2A);
+      break;
 
 #if defined(__AVR_ATmega2560__)
-      case 3:
-        OCR3A = ocr;
-        timer3_toggle_count = toggle_count;
-        bitWrite(TIMSK3, OCIE3A, 1);
-        break;
-      case 4:
-        OCR4A = ocr;
-        timer4_toggle_count = toggle_count;
-        bitWrite(TIMSK4, OCIE4A, 1);
-        break;
-      case 5:
-        OCR5A = ocr;
-        timer5_toggle_count = toggle_count;
-        bitWrite(TIMSK5, OCIE5A, 1);
-        break;
+    case 3:
+      timer3_retune_cs = 0;
+      timer3_retune_ocr = ocr;
+      timer3_retune_cs = prescalarbits;
+      TIMSK3 |= (1 << OCIE3A);
+      break;
+    case 4:
+      timer4_retune_cs = 0;
+      timer4_retune_ocr = ocr;
+      timer4_retune_cs = prescalarbits;
+      TIMSK4 |= (1 << OCIE4A);
+      break;
+    case 5:
+      timer5_retune_cs = 0;
+      timer5_retune_ocr = ocr;
+      timer5_retune_cs = prescalarbits;
+      TIMSK5 |= (1 << OCIE5A);
+      break;
+#endif
+  }
+}
+
+
+// Set the prescalar and OCR for our timer,
+// set the toggle count,
+// then turn on the interrupts.
+// Any pitch change still pending from setFrequency() is dropped.
+// A tone without a duration on the timer's OCnA pin is toggled by the
+// compare output instead (COMnA0, toggle on match) and needs no interrupt;
+// tones with a duration keep the interrupt, which counts the toggles.
+
+void Tone::_start(uint8_t prescalarbits, uint16_t ocr, int32_t toggle_count)
+{
+  bool hw = _hw_toggle && toggle_count < 0;
+
+  switch (_timer)
+  {
+
+#if !defined(__AVR_ATmega8__)
+    case 0:
+      TCCR0B = (TCCR0B & 0b11111000) | prescalarbits;
+      OCR0A = ocr;
+      timer0_toggle_count = toggle_count;
+      timer0_retune_cs = 0;
+      bitWrite(TCCR0A, COM0A0, hw);
+      bitWrite(TIMSK0, OCIE0A, !hw);
+      break;
+#endif
+
+    case 1:
+      TCCR1B = (TCCR1B & 0b11111000) | prescalarbits;
+      OCR1A = ocr;
+      timer1_toggle_count = toggle_count;
+      timer1_retune_cs = 0;
+      bitWrite(TCCR1A, COM1A0, hw);
+      bitWrite(TIMSK1, OCIE1A, !hw);
+      break;
+    case 2:
+      TCCR2B = (TCCR2B & 0b11111000) | prescalarbits;
+      OCR2A = ocr;
+      timer2_toggle_count = toggle_count;
+      timer2_retune_cs = 0;
+      bitWrite(TCCR2A, COM2A0, hw);
+      bitWrite(TIMSK2, OCIE2A, !hw);
+      break;
+
+#if defined(__AVR_ATmega2560__)
+    case 3:
+      TCCR3B = (TCCR3B & 0b11111000) | prescalarbits;
+      OCR3A = ocr;
+      timer3_toggle_count = toggle_count;
+      timer3_retune_cs = 0;
+      bitWrite(TCCR3A, COM3A0, hw);
+      bitWrite(TIMSK3, OCIE3A, !hw);
+      break;
+    case 4:
+      TCCR4B = (TCCR4B & 0b11111000) | prescalarbits;
+      OCR4A = ocr;
+      timer4_toggle_count = toggle_count;
+      timer4_retune_cs = 0;
+      bitWrite(TCCR4A, COM4A0, hw);
+      bitWrite(TIMSK4, OCIE4A, !hw);
+      break;
+    case 5:
+      TCCR5B = (TCCR5B & 0b11111000) | prescalarbits;
+      OCR5A = ocr;
+      timer5_toggle_count = toggle_count;
+      timer5_retune_cs = 0;
+      bitWrite(TCCR5A, COM5A0, hw);
+      bitWrite(TIMSK5, OCIE5A, !hw);
+      break;
 #endif
 
-    }
   }
 }
 
@@ -515,24 +950,30 @@ void Tone::stop()
 #if !defined(__AVR_ATmega8__)
     case 0:
       TIMSK0 &= ~(1 << OCIE0A);
+      TCCR0A &= ~(1 << COM0A0);
       break;
 #endif
     case 1:
       TIMSK1 &= ~(1 << OCIE1A);
+      TCCR1A &= ~(1 << COM1A0);
       break;
     case 2:
       TIMSK2 &= ~(1 << OCIE2A);
+      TCCR2A &= ~(1 << COM2A0);
       break;
 
 #if defined(__AVR_ATmega2560__)
     case 3:
       TIMSK3 &= ~(1 << OCIE3A);
+      TCCR3A &= ~(1 << COM3A0);
       break;
     case 4:
       TIMSK4 &= ~(1 << OCIE4A);
+      TCCR4A &= ~(1 << COM4A0);
       break;
     case 5:
       TIMSK5 &= ~(1 << OCIE5A);
+      TCCR5A &= ~(1 << COM5A0);
       break;
 #endif
   }
@@ -549,26 +990,26 @@ bool Tone::isPlaying(void)
   {
 #if !defined(__AVR_ATmega8__)
     case 0:
-      returnvalue = (TIMSK0 & (1 << OCIE0A));
+      returnvalue = (TIMSK0 & (1 << OCIE0A)) || (TCCR0A & (1 << COM0A0));
       break;
 #endif
 
     case 1:
-      returnvalue = (TIMSK1 & (1 << OCIE1A));
+      returnvalue = (TIMSK1 & (1 << OCIE1A)) || (TCCR1A & (1 << COM1A0));
       break;
     case 2:
-      returnvalue = (TIMSK2 & (1 << OCIE2A));
+      returnvalue = (TIMSK2 & (1 << OCIE2A)) || (TCCR2A & (1 << COM2A0));
       break;
 
 #if defined(__AVR_ATmega2560__)
     case 3:
-      returnvalue = (TIMSK3 & (1 << OCIE3A));
+      returnvalue = (TIMSK3 & (1 << OCIE3A)) || (TCCR3A & (1 << COM3A0));
       break;
     case 4:
-      returnvalue = (TIMSK4 & (1 << OCIE4A));
+      returnvalue = (TIMSK4 & (1 << OCIE4A)) || (TCCR4A & (1 << COM4A0));
       break;
     case 5:
-      returnvalue = (TIMSK5 & (1 << OCIE5A));
+      returnvalue = (TIMSK5 & (1 << OCIE5A)) || (TCCR5A & (1 << COM5A0));
       break;
 #endif
 
@@ -577,3 +1018,39 @@ bool Tone::isPlaying(void)
 }
 
 
+#ifdef TONE_ISR_PROFILE
+
+// Interrupt calls and cycles of this tone's timer over the profile window.
+
+void Tone::profile(uint32_t *calls, uint32_t *cycles)
+{
+  *calls = 0;
+  *cycles = 0;
+  if (_timer < 0)
+    return;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t now = timer0_overflow_count >> TONE_PROFILE_SLOT_SHIFT;
+  for (uint8_t i = 0; i < TONE_PROFILE_SLOTS; i++)
+  {
+    const tone_profile_slot *slot = &tone_profile[_timer][i];
+    // the complete slots before the current one
+    if ((uint16_t)(now - slot->epoch - 1) < TONE_PROFILE_SLOTS - 1)
+    {
+      *calls += slot->calls;
+      *cycles += slot->cycles;
+    }
+  }
+  SREG = oldSREG;
+}
+
+
+// Length of the profile window in CPU cycles.
+
+uint32_t Tone::profileWindowCycles()
+{
+  return (uint32_t)(TONE_PROFILE_SLOTS - 1) << (TONE_PROFILE_SLOT_SHIFT + 14);
+}
+
+#endif
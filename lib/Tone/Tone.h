@@ -137,6 +137,19 @@
 #define NOTE_DS8 4978
 
 
+/*
+|| Interrupt profiling (build with -DTONE_ISR_PROFILE, Arduino core only)
+||
+|| Each compare interrupt adds one call and the cycles since its compare
+|| match to a slot of its timer. A slot spans 2^TONE_PROFILE_SLOT_SHIFT
+|| overflows of the millis() timer (2^14 cycles each), and the window is
+|| the TONE_PROFILE_SLOTS - 1 slots before the current one.
+*/
+
+#define TONE_PROFILE_SLOTS      4    // power of two
+#define TONE_PROFILE_SLOT_SHIFT 8    // 2^22 cycles, 262 ms at 16 MHz
+
+
 /*
 || Definitions
 */
@@ -147,12 +160,24 @@ class Tone
     void begin(uint8_t tonePin);
     bool isPlaying();
     void play(uint16_t frequency, uint32_t duration = 0);
+    void playMidiNote(uint8_t note);
+    void setFrequency(uint16_t frequency);
+    void setMidiNote(uint8_t note);
     void stop();
 
+#ifdef TONE_ISR_PROFILE
+    void profile(uint32_t *calls, uint32_t *cycles);
+    static uint32_t profileWindowCycles();
+#endif
+
   private:
+    void _start(uint8_t prescalarbits, uint16_t ocr, int32_t toggle_count);
+    void _retune(uint8_t prescalarbits, uint16_t ocr);
+
     static uint8_t _tone_pin_count;
     uint8_t _pin;
     int8_t _timer;
+    bool _hw_toggle;
 };
 
 #endif
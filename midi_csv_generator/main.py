@@ -2,12 +2,16 @@
 """
 midi_csv_generator/main.py
 
-Convert a MIDI file into a CSV of note events for the Arduino player.
+Convert a MIDI file into a song for the Arduino player: a CSV of note events,
+or the player's binary song format (fixed or delta-encoded records, see
+include/song_format.h), optionally together with its seek index sidecar.
 Reads the tempo from the MIDI file if present; otherwise falls back to the default BPM.
 """
 
-import sys
+import argparse
+import io
 import os
+import struct
 import mido
 import csv
 import math
@@ -35,6 +39,30 @@ role_map = {
     # Other channels default to 0.5
 }
 
+# -----------------------------------------------------------------------------
+# Binary song / seek index layout (must match include/song_format.h)
+# -----------------------------------------------------------------------------
+SONG_EXT       = '.bzs'
+SONG_MAGIC     = b'BZSG'
+SONG_VERSION   = 1
+SONG_FORMATS   = {'bin': 0, 'delta': 1}     # SONG_FMT_FIXED, SONG_FMT_DELTA
+SONG_HEADER    = struct.Struct('<4sBBHIIB3xI')     # SongHeader
+SONG_RECORD    = struct.Struct('<HIIB')            # fixed record
+
+INDEX_EXT_PREFIX = 'I'
+INDEX_MAGIC      = b'BZIX'
+INDEX_VERSION    = 6
+INDEX_INTERVAL   = 2_000_000                       # µs
+INDEX_MAX_VOICES = 8
+INDEX_HEADER     = struct.Struct('<4sBBHIII')      # IndexHeader
+INDEX_ENTRY      = struct.Struct('<III')           # IndexEntry without voices
+INDEX_VOICE      = struct.Struct('<BII')           # IndexVoice
+
+# Run-time allocation of unassigned notes (must match include/voices.h)
+VOICE_KEEP_W_DUR   = 4
+VOICE_KEEP_W_PITCH = 1
+VOICE_MID_PITCH    = 66
+
 def get_note_name(note):
     """Convert a MIDI note number to scientific pitch name (e.g. 60 → 'C4')."""
     note_names = ['C', 'C#', 'D', 'D#', 'E', 'F',
@@ -46,11 +74,27 @@ def get_frequency(note):
     """Convert a MIDI note number to frequency in Hz (A4 = 440 Hz)."""
     return 440.0 * (2 ** ((note - 69) / 12))
 
+def get_played_note(freq):
+    """
+    The MIDI note the player plays for a frequency in Hz: the nearest entry
+    of its rounded pitch table (pitch_hz_to_note() in src/pitch.cpp). Below
+    about C1 neighbouring notes round to the same Hz, so this need not give
+    back the note the frequency was made from.
+    """
+    table = [round(get_frequency(n)) for n in range(128)]
+    lo = next((n for n in range(128) if table[n] >= freq), 127)
+    if lo > 0 and freq - table[lo - 1] < table[lo] - freq:
+        lo -= 1
+    return lo
+
 
-def midi_to_csv(midi_file_path, output_csv_path):
+def parse_midi(midi_file_path, assign=True):
     """
-    Parse the MIDI file and write out a CSV of note events:
-      note name, frequency (Hz), start_time (µs), end_time (µs), buzzer index.
+    Parse the MIDI file and assign every note to a buzzer.
+    Returns the notes sorted by start time as dicts
+      {note, start, end, buzzer, velocity, role}, with times in seconds.
+    With assign=False every note keeps its full length and gets buzzer 0,
+    leaving the choice to the player at run time.
     """
     # Load the MIDI file
     try:
@@ -105,6 +149,9 @@ def midi_to_csv(midi_file_path, output_csv_path):
     # 3) Sort by start time
     raw_notes.sort(key=lambda x: x['start'])
 
+    if not assign:
+        return [dict(ev, buzzer=0) for ev in raw_notes]
+
     # 4) Assign buzzers with hybrid preemption ranking
     free_buzzers = list(range(1, num_buzzers + 1))
     heapq.heapify(free_buzzers)
@@ -164,33 +211,247 @@ def midi_to_csv(midi_file_path, output_csv_path):
         })
         heapq.heappush(active_heap, (assigned_end, note_id, buzzer))
 
-    # 5) Write out the CSV file
-    with open(output_csv_path, 'w', newline='', encoding='utf-8') as csvfile:
-        writer = csv.writer(csvfile)
-        writer.writerow(['note', 'frequency', 'start_us', 'end_us', 'buzzer'])
-        for r in results:
-            note_name = get_note_name(r['note'])
-            freq      = round(get_frequency(r['note']))
-            start_us  = int(r['start'] * 1_000_000)
-            end_us    = int(r['end']   * 1_000_000)
-            writer.writerow([note_name, freq, start_us, end_us, r['buzzer']])
+    return results
+
+
+def to_events(results, tick_us):
+    """
+    Convert parsed notes to integer events as stored in the file:
+      (note, frequency, start, end, buzzer) with times in ticks of tick_us µs.
+    """
+    events = []
+    for r in results:
+        events.append((r['note'],
+                       round(get_frequency(r['note'])),
+                       int(r['start'] * 1_000_000 / tick_us),
+                       int(r['end']   * 1_000_000 / tick_us),
+                       r['buzzer']))
+    return events
+
+
+def max_polyphony(events):
+    """Most notes sounding at the same time."""
+    edges = []
+    for _, _, start, end, _ in events:
+        if end > start:
+            edges.append((start, 1))
+            edges.append((end, -1))
+    # Ends sort before starts at the same instant
+    edges.sort(key=lambda x: (x[0], x[1]))
+    peak = count = 0
+    for _, step in edges:
+        count += step
+        peak = max(peak, count)
+    return peak
+
+
+def encode_csv(events):
+    """
+    Encode events as CSV text:
+      note name, frequency (Hz), start_time (µs), end_time (µs), buzzer index.
+    Returns (file bytes, offset of each record).
+    """
+    buf = io.StringIO(newline='')
+    writer = csv.writer(buf)
+    writer.writerow(['note', 'frequency', 'start_us', 'end_us', 'buzzer'])
+    data = bytearray(buf.getvalue().encode('utf-8'))
+    offsets = []
+    for note, freq, start, end, buzzer in events:
+        buf.seek(0)
+        buf.truncate()
+        writer.writerow([get_note_name(note), freq, start, end, buzzer])
+        offsets.append(len(data))
+        data += buf.getvalue().encode('utf-8')
+    return bytes(data), offsets
+
+
+def put_varint(out, value):
+    """Append value as an unsigned LEB128 varint."""
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def encode_binary(events, fmt, tick_us):
+    """
+    Encode events as a binary song (fmt 'bin' or 'delta') with the metadata
+    header filled in. Returns (file bytes, offset of each record).
+    """
+    duration = max((e[3] for e in events), default=0)
+    data = bytearray(SONG_HEADER.pack(SONG_MAGIC, SONG_VERSION, SONG_FORMATS[fmt],
+                                      SONG_HEADER.size, len(events), duration,
+                                      min(max_polyphony(events), 255), tick_us))
+    offsets = []
+    prev_start = 0
+    for note, freq, start, end, buzzer in events:
+        offsets.append(len(data))
+        if fmt == 'bin':
+            data += SONG_RECORD.pack(freq, start, end, buzzer)
+        else:
+            put_varint(data, start - prev_start)
+            put_varint(data, end - start)
+            data += bytes((note, buzzer))
+            prev_start = start
+    return bytes(data), offsets
+
+
+def index_name(song_path):
+    """
+    Sidecar path of a song's seek index, as seek_index.cpp names it: the
+    extension becomes 'I' plus the first two letters of the song's
+    (SONG.CSV -> SONG.ICS), lower case for a lower-case extension.
+    """
+    base, ext = os.path.splitext(song_path)
+    ext = ext[1:3]
+    prefix = INDEX_EXT_PREFIX.lower() if ext[:1].islower() else INDEX_EXT_PREFIX
+    return f"{base}.{prefix}{ext}"
+
+
+def allocate_voice(voices, count, start):
+    """
+    The voice the player's voices_allocate() gives an unassigned note
+    starting at start: the first of count voices that is silent or whose
+    note has ended, else the one with the lowest keep score. voices holds
+    (note, start, end) or None per voice; the integer maths is the player's.
+    """
+    for v in range(count):
+        if voices[v] is None or voices[v][2] <= start:
+            return v
+    durs = [min((v_end - v_start) >> 10, 0xFFFF)
+            for _, v_start, v_end in voices[:count]]
+    max_dur = max(durs) or 1
+    victim, lowest = 0, None
+    for v in range(count):
+        dist  = abs(voices[v][0] - VOICE_MID_PITCH)
+        close = VOICE_MID_PITCH - dist if dist < VOICE_MID_PITCH else 0
+        keep  = (VOICE_KEEP_W_DUR * VOICE_MID_PITCH * (max_dur - durs[v])
+                 + VOICE_KEEP_W_PITCH * max_dur * close)
+        if lowest is None or keep < lowest:
+            victim, lowest = v, keep
+    return victim
+
+
+def encode_index(events, offsets, song_size, fmt, tick_us, buzzers=num_buzzers):
+    """
+    Build the seek index for an encoded song, entry for entry what the
+    player's seek_index.cpp would write when scanning it: one entry per
+    INDEX_INTERVAL checkpoint before each event's start, holding the offset
+    of that event and what each of the player's buzzers is playing.
+    Unassigned notes (buzzer 0) are placed as the player allocates them for
+    that many buzzers, and notes on buzzers past it are dropped. Index times
+    are in µs; baseTime stays in file ticks.
+    """
+    entries = []
+    voices = [None] * INDEX_MAX_VOICES          # (note, start, end) per buzzer
+    checkpoint = 0
+    base = 0
+    for i, (note, freq, tick_start, tick_end, buzzer) in enumerate(events):
+        start = tick_start * tick_us
+        end   = tick_end * tick_us
+        while start > checkpoint:
+            entry = bytearray(INDEX_ENTRY.pack(checkpoint, offsets[i], base))
+            for voice in voices:
+                if voice is None or voice[2] <= checkpoint:
+                    voice = (0, 0, 0)
+                entry += INDEX_VOICE.pack(*voice)
+            entries.append(bytes(entry))
+            checkpoint += INDEX_INTERVAL
+        # CSV and fixed records store Hz, which the player maps back to a note
+        played = note if fmt == 'delta' else get_played_note(freq)
+        if buzzer == 0:
+            voices[allocate_voice(voices, buzzers, start)] = (played, start, end)
+        elif buzzer <= buzzers:
+            voices[buzzer - 1] = (played, start, end)
+        # Delta records resume from the previous event's start time
+        if fmt == 'delta':
+            base = tick_start
+
+    header = INDEX_HEADER.pack(INDEX_MAGIC, INDEX_VERSION, buzzers,
+                               INDEX_HEADER.size, INDEX_INTERVAL, song_size,
+                               len(entries))
+    return header + b''.join(entries)
+
+
+def convert(midi_file_path, output_path, fmt='csv', index=False, tick_us=1,
+            assign=True, buzzers=num_buzzers):
+    """
+    Write the song for midi_file_path to output_path in the given format
+    ('csv', 'bin' or 'delta'), plus its seek index when index is set.
+    Binary songs use ticks of tick_us µs; CSV is always in µs (start_us).
+    assign=False leaves every note unassigned (see parse_midi). The index
+    is built for a player with the given number of buzzers (NUM_BUZZERS).
+    Returns (events, duration in µs, max polyphony).
+    """
+    results = parse_midi(midi_file_path, assign)
+
+    if fmt == 'csv':
+        tick_us = 1
+        events = to_events(results, tick_us)
+        data, offsets = encode_csv(events)
+    else:
+        events = to_events(results, tick_us)
+        data, offsets = encode_binary(events, fmt, tick_us)
+
+    with open(output_path, 'wb') as f:
+        f.write(data)
+
+    if index:
+        index_path = index_name(output_path)
+        with open(index_path, 'wb') as f:
+            f.write(encode_index(events, offsets, len(data), fmt, tick_us,
+                                 buzzers))
+
+    duration = max((e[3] for e in events), default=0) * tick_us
+    return len(events), duration, max_polyphony(events)
+
+
+def midi_to_csv(midi_file_path, output_csv_path):
+    """Convert a MIDI file into a CSV of note events."""
+    convert(midi_file_path, output_csv_path, 'csv')
 
 
 if __name__ == '__main__':
     # Command-line interface
-    if len(sys.argv) != 2:
-        print(f"Usage: python {os.path.basename(__file__)} input_file.mid")
-        sys.exit(1)
+    parser = argparse.ArgumentParser(
+        description="Convert a MIDI file into a song for the Arduino buzzer player.")
+    parser.add_argument('input', help="input .mid file")
+    parser.add_argument('-f', '--format', choices=['csv', 'bin', 'delta'], default='csv',
+                        help="csv text, fixed binary records, or delta/varint "
+                             "binary records (default: csv)")
+    parser.add_argument('-o', '--output',
+                        help="output path (default: input name with .csv or "
+                             f"{SONG_EXT})")
+    parser.add_argument('-i', '--index', action='store_true',
+                        help="also write the seek index next to the output "
+                             "(SONG.BZS -> SONG.IBZ)")
+    parser.add_argument('-b', '--buzzers', type=int, default=num_buzzers,
+                        help="NUM_BUZZERS of the player the seek index is for "
+                             f"(default {num_buzzers}); the player rebuilds an "
+                             "index made for another count")
+    parser.add_argument('-t', '--tick-us', type=int, default=1,
+                        help="time resolution of binary songs in µs (default 1; "
+                             "1000 gives smaller delta files at ms resolution)")
+    parser.add_argument('-u', '--unassigned', action='store_true',
+                        help="leave notes unassigned (buzzer 0) for the player "
+                             "to allocate, so the song fits any number of buzzers")
+    args = parser.parse_args()
 
-    midi_file_path = sys.argv[1]
+    midi_file_path = args.input
     if not os.path.isfile(midi_file_path):
-        print(f"Error: MIDI file '{midi_file_path}' not found.")
-        sys.exit(1)
+        parser.exit(1, f"Error: MIDI file '{midi_file_path}' not found.\n")
 
     base, ext = os.path.splitext(midi_file_path)
     if ext.lower() != '.mid':
         print("Warning: input file does not have .mid extension; proceeding anyway.")
 
-    output_csv_path = base + '.csv'
-    midi_to_csv(midi_file_path, output_csv_path)
-    print(f"Conversion complete; CSV saved to: {output_csv_path}")
+    output_path = args.output or base + ('.csv' if args.format == 'csv' else SONG_EXT)
+    if args.tick_us < 1:
+        parser.exit(1, "Error: --tick-us must be at least 1.\n")
+    if not 1 <= args.buzzers <= INDEX_MAX_VOICES:
+        parser.exit(1, f"Error: --buzzers must be 1..{INDEX_MAX_VOICES}.\n")
+    count, duration, poly = convert(midi_file_path, output_path, args.format,
+                                    args.index, args.tick_us, not args.unassigned,
+                                    args.buzzers)
+    print(f"Conversion complete; {count} notes, {duration / 1e6:.3f} s, "
+          f"max polyphony {poly}; saved to: {output_path}")
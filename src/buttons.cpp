@@ -0,0 +1,116 @@
+// buttons.cpp
+// Tick-sampled, debounced buttons. The tick is the only producer and
+// loop() the only consumer of the ring, using the same lock-free scheme as
+// event_queue.cpp.
+
+#include "buttons.h"
+
+#if (BUTTONS_QUEUE_SIZE & (BUTTONS_QUEUE_SIZE - 1)) != 0 || BUTTONS_QUEUE_SIZE > 128
+#error "BUTTONS_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
+#define BUTTONS_QUEUE_MASK (BUTTONS_QUEUE_SIZE - 1)
+
+struct Button {
+    uint8_t  pin;
+    bool     pressed;       // Debounced state
+    uint32_t changedMs;     // Time of the last accepted change
+    uint32_t repeatMs;      // Time of the next repeat while held
+};
+
+// --- Static module state ---
+static Button           buttons[BUTTONS_MAX];
+static uint8_t          buttonCount;
+static uint8_t          repeatMask;
+static ButtonEvent      ring[BUTTONS_QUEUE_SIZE];
+static volatile uint8_t head;
+static volatile uint8_t tail;
+static uint16_t         dropped;
+
+// ----------------------------------------------------------------------------
+// push(button, repeat)
+//   Tick side. Repeats give way while the ring is filling up.
+// ----------------------------------------------------------------------------
+static void push(uint8_t button, bool repeat) {
+    uint8_t t    = tail;
+    uint8_t used = (uint8_t)(t - head);
+    if (repeat && used > BUTTONS_QUEUE_SIZE / 2) return;
+    if (used >= BUTTONS_QUEUE_SIZE) {
+        if (dropped != UINT16_MAX) dropped++;
+        return;
+    }
+    ring[t & BUTTONS_QUEUE_MASK].button = button;
+    ring[t & BUTTONS_QUEUE_MASK].repeat = repeat;
+    HAL_BARRIER();
+    tail = t + 1;
+}
+
+// ----------------------------------------------------------------------------
+// sample()
+//   Tick callback. A level change is taken as soon as it is seen, then
+//   further changes are ignored for BUTTONS_DEBOUNCE_MS, so a press is
+//   reported on its first edge.
+// ----------------------------------------------------------------------------
+static void sample(void) {
+    uint32_t now = hal_millis();
+    for (uint8_t i = 0; i < buttonCount; i++) {
+        Button& b   = buttons[i];
+        bool    low = !hal_input_read(b.pin);
+
+        if (low != b.pressed) {
+            if (now - b.changedMs < BUTTONS_DEBOUNCE_MS) continue;
+            b.pressed   = low;
+            b.changedMs = now;
+            if (low) {
+                b.repeatMs = now + BUTTONS_REPEAT_DELAY_MS;
+                push(i, false);
+            }
+        } else if (low && (repeatMask & (1 << i))
+                   && (int32_t)(now - b.repeatMs) >= 0) {
+            b.repeatMs += BUTTONS_REPEAT_MS;
+            push(i, true);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// buttons_begin(pins, count, repeatMask)
+// ----------------------------------------------------------------------------
+void buttons_begin(const uint8_t* pins, uint8_t count, uint8_t mask) {
+    if (count > BUTTONS_MAX) count = BUTTONS_MAX;
+
+    hal_tick_begin(nullptr);
+    uint32_t now = hal_millis();
+    for (uint8_t i = 0; i < count; i++) {
+        hal_input_begin(pins[i]);
+        buttons[i].pin       = pins[i];
+        buttons[i].pressed   = false;   // Held at start: reported as a press
+        buttons[i].changedMs = now;
+        buttons[i].repeatMs  = now;
+    }
+    buttonCount = count;
+    repeatMask  = mask;
+    head        = 0;
+    tail        = 0;
+    dropped     = 0;
+    hal_tick_begin(sample);
+}
+
+// ----------------------------------------------------------------------------
+// buttons_pop(ev)
+// ----------------------------------------------------------------------------
+bool buttons_pop(ButtonEvent* ev) {
+    uint8_t h = head;
+    if (h == tail) return false;
+    *ev = ring[h & BUTTONS_QUEUE_MASK];
+    HAL_BARRIER();
+    head = h + 1;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// buttons_dropped()
+// ----------------------------------------------------------------------------
+uint16_t buttons_dropped(void) {
+    return dropped;
+}
@@ -0,0 +1,135 @@
+// event_queue.cpp
+// Single-producer (loop) / single-consumer (scheduler) ring of NoteEvents.
+// The scheduler runs in interrupt context: a slot is filled before tail
+// moves past it and read before head releases it, and each index is only
+// written by one side, so no locking is needed.
+
+#include "event_queue.h"
+
+#if (EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) != 0 || EVENT_QUEUE_SIZE > 128
+#error "EVENT_QUEUE_SIZE must be a power of two no larger than 128"
+#endif
+
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_SIZE - 1)
+
+// --- Static module state ---
+// Ring storage; head is the next slot to pop, tail the next slot to fill.
+// Both only ever increase (mod 256) so count = tail - head.
+static NoteEvent        ring[EVENT_QUEUE_SIZE];
+static volatile uint8_t head;
+static volatile uint8_t tail;
+
+// Events that were due while still on the SD card. Scheduler side: starved
+// is set when it finds the ring empty, starvedAt is the last time it did.
+static uint16_t      underruns;
+static bool          starved;
+static unsigned long starvedAt;
+
+// ----------------------------------------------------------------------------
+// event_queue_reset()
+//   Drop all queued events and clear the underrun counter.
+// ----------------------------------------------------------------------------
+void event_queue_reset(void) {
+    head      = 0;
+    tail      = 0;
+    underruns = 0;
+    starved   = false;
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_count()
+//   Number of events waiting in the ring.
+// ----------------------------------------------------------------------------
+uint8_t event_queue_count(void) {
+    return (uint8_t)(tail - head);
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_push(e)
+//   Copy one event into the tail slot. Returns false if the ring is full.
+// ----------------------------------------------------------------------------
+bool event_queue_push(const NoteEvent* e) {
+    if (event_queue_count() >= EVENT_QUEUE_SIZE) {
+        return false;
+    }
+    ring[tail & EVENT_QUEUE_MASK] = *e;
+    HAL_BARRIER();
+    tail = tail + 1;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_refill(maxEvents)
+//   Parse events straight into free ring slots, at most maxEvents of them.
+// ----------------------------------------------------------------------------
+uint8_t event_queue_refill(uint8_t maxEvents) {
+    uint8_t added = 0;
+    while (added < maxEvents && event_queue_count() < EVENT_QUEUE_SIZE) {
+        if (!sd_read_next_event(&ring[tail & EVENT_QUEUE_MASK])) {
+            break;
+        }
+        HAL_BARRIER();
+        tail = tail + 1;
+        added++;
+    }
+    return added;
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_peek()
+//   Oldest queued event, or nullptr.
+// ----------------------------------------------------------------------------
+const NoteEvent* event_queue_peek(void) {
+    if (head == tail) {
+        return nullptr;
+    }
+    return &ring[head & EVENT_QUEUE_MASK];
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_peek_due(now)
+//   Oldest queued event if due, tracking starvation for the underrun count.
+// ----------------------------------------------------------------------------
+const NoteEvent* event_queue_peek_due(unsigned long now) {
+    if (head == tail) {
+        if (!sd_finished()) {
+            starved   = true;
+            starvedAt = now;
+        }
+        return nullptr;
+    }
+
+    const NoteEvent* ev = &ring[head & EVENT_QUEUE_MASK];
+    if (starved) {
+        starved = false;
+        if (ev->startTime <= starvedAt && underruns != UINT16_MAX) underruns++;
+    }
+    return ev->startTime <= now ? ev : nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_pop()
+//   Release the head slot.
+// ----------------------------------------------------------------------------
+void event_queue_pop(void) {
+    if (head != tail) {
+        HAL_BARRIER();
+        head = head + 1;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_drained()
+//   True once the song is exhausted and every queued event was consumed.
+// ----------------------------------------------------------------------------
+bool event_queue_drained(void) {
+    return head == tail && sd_finished();
+}
+
+// ----------------------------------------------------------------------------
+// event_queue_underruns()
+//   Underrun count since the last reset.
+// ----------------------------------------------------------------------------
+uint16_t event_queue_underruns(void) {
+    return underruns;
+}
@@ -0,0 +1,319 @@
+// hal_arduino.cpp
+// HAL implementation on the Arduino core, the SD library and the Tone library
+// (or, with HAL_TONE_DDS, the single-timer engine in tone_dds.cpp).
+
+#ifdef ARDUINO
+
+#include "hal.h"
+#ifdef HAL_TONE_DDS
+#include "tone_dds.h"
+#else
+#include <Tone.h>
+
+// One Tone object (hardware timer) per voice
+static Tone tones[HAL_MAX_VOICES];
+static uint8_t toneVoices;     // Voices attached so far
+#endif
+
+// -----------------------------------------------------------------------------
+// Clock
+// -----------------------------------------------------------------------------
+uint32_t hal_millis(void) {
+    return millis();
+}
+
+uint32_t hal_micros(void) {
+    return micros();
+}
+
+void hal_enable_interrupts(void) {
+    interrupts();
+}
+
+uint8_t hal_irq_save(void) {
+    uint8_t state = SREG;
+    cli();
+    return state;
+}
+
+void hal_irq_restore(uint8_t state) {
+    SREG = state;
+}
+
+// -----------------------------------------------------------------------------
+// Scheduler timer (timer0 compare B)
+//   Timer0 keeps running millis()/micros(): it ticks every 4 µs and wraps
+//   every 1.024 ms. Compare A belongs to the Tone library (its sixth voice),
+//   compare B is otherwise unused. Until the deadline falls within one timer
+//   period the compare fires once per wrap and re-checks; then OCR0B is
+//   placed on the deadline tick, so the vector fires within 4 µs of it.
+//   The Arduino core runs timer0 in Fast PWM mode, where OCR0B writes only
+//   take effect at the next wrap and a deadline later in the current period
+//   would fire one period late. timerMode() switches it to normal mode,
+//   which wraps and overflows identically but loads OCR0B at once. (PWM
+//   from analogWrite() on timer0's pins stops working.)
+//   With a tick callback installed the compare stays enabled while the
+//   scheduler is disarmed, so the vector fires at least once per wrap.
+// -----------------------------------------------------------------------------
+static HalTimerCallback  timerFn;
+static HalTimerCallback  tickFn;
+static volatile uint32_t timerAt;       // micros() value of the deadline
+static volatile bool     timerArmed;
+
+// Normal mode (WGM0 = 0): same 256-tick count and overflow, unbuffered OCR0B
+static void timerMode(void) {
+    uint8_t state = hal_irq_save();
+    TCCR0A &= ~(_BV(WGM01) | _BV(WGM00));
+    TCCR0B &= ~_BV(WGM02);
+    hal_irq_restore(state);
+}
+
+// Interrupts must be off
+static void timerSetCompare(void) {
+    int32_t left = (int32_t)(timerAt - micros());
+    if (left < 256L * 4) {
+        uint8_t ticks = left > 8 ? (uint8_t)(left / 4) : 2;
+        OCR0B = TCNT0 + ticks;
+    }
+}
+
+void hal_timer_begin(HalTimerCallback fn) {
+    hal_timer_disarm();
+    timerMode();
+    timerFn = fn;
+}
+
+void hal_timer_arm(uint32_t delayUs) {
+    uint8_t state = hal_irq_save();
+    timerAt    = micros() + delayUs;
+    timerArmed = true;
+    TIFR0  = _BV(OCF0B);     // Drop a stale match
+    timerSetCompare();
+    TIMSK0 |= _BV(OCIE0B);
+    hal_irq_restore(state);
+}
+
+void hal_timer_disarm(void) {
+    uint8_t state = hal_irq_save();
+    timerArmed = false;
+    if (!tickFn) TIMSK0 &= ~_BV(OCIE0B);
+    hal_irq_restore(state);
+}
+
+void hal_tick_begin(HalTimerCallback fn) {
+    timerMode();
+    uint8_t state = hal_irq_save();
+    tickFn = fn;
+    if (fn) {
+        TIMSK0 |= _BV(OCIE0B);
+    } else if (!timerArmed) {
+        TIMSK0 &= ~_BV(OCIE0B);
+    }
+    hal_irq_restore(state);
+}
+
+ISR(TIMER0_COMPB_vect) {
+    if (tickFn) tickFn();
+    if (!timerArmed) return;
+    if ((int32_t)(micros() - timerAt) < 0) {
+        timerSetCompare();
+        return;
+    }
+
+    // Run the callback with this vector masked but interrupts on, so the
+    // Tone timers and millis() are not held off while notes are scheduled
+    timerArmed = false;
+    TIMSK0 &= ~_BV(OCIE0B);
+    sei();
+    timerFn();
+    cli();
+    if (timerArmed || tickFn) TIMSK0 |= _BV(OCIE0B);
+}
+
+// -----------------------------------------------------------------------------
+// Input pins
+// -----------------------------------------------------------------------------
+void hal_input_begin(uint8_t pin) {
+    pinMode(pin, INPUT_PULLUP);
+}
+
+bool hal_input_read(uint8_t pin) {
+    return digitalRead(pin) == HIGH;
+}
+
+// -----------------------------------------------------------------------------
+// Console (Serial)
+// -----------------------------------------------------------------------------
+void hal_print(const char* s)                    { Serial.print(s); }
+void hal_print(uint32_t v)                       { Serial.print(v); }
+void hal_print(const __FlashStringHelper* s)     { Serial.print(s); }
+void hal_println(const char* s)                  { Serial.println(s); }
+void hal_println(uint32_t v)                     { Serial.println(v); }
+void hal_println(const __FlashStringHelper* s)   { Serial.println(s); }
+
+size_t hal_write(const void* buf, size_t len) {
+    return Serial.write((const uint8_t*)buf, len);
+}
+
+size_t hal_write_room(void) {
+    return Serial.availableForWrite();
+}
+
+// -----------------------------------------------------------------------------
+// Tone output
+// -----------------------------------------------------------------------------
+#ifdef HAL_TONE_DDS
+
+void hal_tone_begin(uint8_t voice, uint8_t pin)        { tone_dds_begin(voice, pin); }
+void hal_tone_play(uint8_t voice, uint16_t frequency)  { tone_dds_play(voice, frequency); }
+void hal_tone_play_note(uint8_t voice, uint8_t note)   { tone_dds_play_note(voice, note); }
+void hal_tone_stop(uint8_t voice)                      { tone_dds_stop(voice); }
+void hal_tone_dump_load(void)                          { tone_dds_dump_load(); }
+
+#else
+
+void hal_tone_begin(uint8_t voice, uint8_t pin) {
+    if (voice < HAL_MAX_VOICES) {
+        tones[voice].begin(pin);
+        if (voice >= toneVoices) toneVoices = voice + 1;
+    }
+}
+
+void hal_tone_play(uint8_t voice, uint16_t frequency) {
+    if (voice < HAL_MAX_VOICES) tones[voice].setFrequency(frequency);
+}
+
+void hal_tone_play_note(uint8_t voice, uint8_t note) {
+    if (voice < HAL_MAX_VOICES) tones[voice].setMidiNote(note);
+}
+
+void hal_tone_stop(uint8_t voice) {
+    if (voice < HAL_MAX_VOICES) tones[voice].stop();
+}
+
+// -----------------------------------------------------------------------------
+// hal_tone_dump_load()
+//   "[TONE] voice=<n> irq_per_s avg_cycles load_pct" per attached voice over
+//   the Tone profile window, then the sum. Voices toggled by their timer's
+//   compare output show no interrupts.
+// -----------------------------------------------------------------------------
+static void printPermille(uint32_t permille) {
+    hal_print(permille / 10);
+    hal_print(F("."));
+    hal_println(permille % 10);
+}
+
+void hal_tone_dump_load(void) {
+#ifdef TONE_ISR_PROFILE
+    uint32_t window   = Tone::profileWindowCycles();
+    uint32_t windowMs = window / (F_CPU / 1000);
+    uint32_t total    = 0;
+    hal_print(F("[TONE] window_ms="));
+    hal_println(windowMs);
+    for (uint8_t v = 0; v < toneVoices; v++) {
+        uint32_t calls, cycles;
+        tones[v].profile(&calls, &cycles);
+        uint32_t permille = cycles / (window / 1000);
+        total += permille;
+        hal_print(F("[TONE] voice="));
+        hal_print(v);
+        hal_print(F(" irq_per_s="));
+        hal_print(calls * 1000 / windowMs);
+        hal_print(F(" avg_cycles="));
+        hal_print(calls ? cycles / calls : 0);
+        hal_print(F(" load_pct="));
+        printPermille(permille);
+    }
+    hal_print(F("[TONE] total load_pct="));
+    printPermille(total);
+#else
+    hal_println(F("[TONE] build with -DTONE_ISR_PROFILE to measure load"));
+#endif
+}
+
+#endif // HAL_TONE_DDS
+
+// -----------------------------------------------------------------------------
+// File storage (SD library)
+// -----------------------------------------------------------------------------
+bool HalFile::open(const char* path, HalFileMode mode) {
+    close();
+    switch (mode) {
+        case HAL_FILE_READ:   file = SD.open(path, FILE_READ);                  break;
+        case HAL_FILE_RDWR:   file = SD.open(path, O_RDWR);                     break;
+        case HAL_FILE_CREATE: file = SD.open(path, O_RDWR | O_CREAT | O_TRUNC); break;
+    }
+    return isOpen();
+}
+
+void HalFile::close(void) {
+    if (file) file.close();
+}
+
+bool HalFile::isOpen(void) const {
+    // File::operator bool is not const in the SD library
+    return const_cast<File&>(file);
+}
+
+int HalFile::read(void* buf, uint16_t len) {
+    return file.read(buf, len);
+}
+
+size_t HalFile::write(const void* buf, size_t len) {
+    return file.write((const uint8_t*)buf, len);
+}
+
+bool HalFile::seek(uint32_t pos) {
+    return file.seek(pos);
+}
+
+uint32_t HalFile::position(void) {
+    return file.position();
+}
+
+uint32_t HalFile::size(void) {
+    return file.size();
+}
+
+void HalFile::flush(void) {
+    file.flush();
+}
+
+bool HalDir::open(const char* path) {
+    dir = SD.open(path);
+    if (!dir) return false;
+    dir.rewindDirectory();
+    return true;
+}
+
+bool HalDir::next(char* name, size_t len) {
+    File entry;
+    while ((entry = dir.openNextFile())) {
+        bool isDir = entry.isDirectory();
+        if (!isDir) {
+            strncpy(name, entry.name(), len);
+            name[len - 1] = '\0';
+        }
+        entry.close();
+        if (!isDir) return true;
+    }
+    return false;
+}
+
+void HalDir::close(void) {
+    if (dir) dir.close();
+}
+
+bool hal_fs_begin(uint8_t csPin) {
+    return SD.begin(csPin);
+}
+
+bool hal_fs_exists(const char* path) {
+    return SD.exists(path);
+}
+
+bool hal_fs_remove(const char* path) {
+    return SD.remove(path);
+}
+
+#endif // ARDUINO
@@ -1,86 +1,116 @@
 #include "logger.h"
 
 // File handle for the log file ("player.log")
-static File    logFile;
+static HalFile logFile;
 
 // Current write index (0..LOG_MAX_ENTRIES-1) into the circular log
 static uint16_t logIndex = 0;
 
-// Temporary buffer for building a single log record
-static char recordBuf[LOG_RECORD_SIZE];
+// Records built by log_event() and not yet written to the card
+static char    pending[LOG_QUEUE_SIZE][LOG_RECORD_SIZE];
+static uint8_t pendingHead  = 0;   // Oldest record
+static uint8_t pendingCount = 0;
 
 /**
  * @brief Initialize the logging system.
  * 
- * - Calls SD.begin() on the given chip-select pin.
+ * - Initializes the SD card (hal_fs_begin) on the given chip-select pin.
  * - If “player.log” does not exist, creates it and pre-allocates
  *   LOG_MAX_ENTRIES * LOG_RECORD_SIZE bytes filled with spaces and newlines.
  * - Opens “player.log” in read/write mode (without append).
- * - Resets the circular index to zero.
+ * - Resets the circular index to zero and drops unwritten records.
  * 
  * @param csPin  SD card chip-select pin.
  * @return true on successful initialization; false on any error.
  */
 bool log_init(uint8_t csPin) {
     // Initialize SD interface
-    if (!SD.begin(csPin)) return false;
+    if (!hal_fs_begin(csPin)) return false;
 
     // Pre-allocate log file if it doesn't exist
-    if (!SD.exists("player.log")) {
-        File f = SD.open("player.log", FILE_WRITE);
-        if (!f) return false;
+    if (!hal_fs_exists("player.log")) {
+        HalFile f;
+        if (!f.open("player.log", HAL_FILE_CREATE)) return false;
 
-        // Fill buffer with spaces, ending with '\n'
-        memset(recordBuf, ' ', LOG_RECORD_SIZE - 1);
-        recordBuf[LOG_RECORD_SIZE - 1] = '\n';
+        // Fill a record with spaces, ending with '\n'
+        char* blank = pending[0];
+        memset(blank, ' ', LOG_RECORD_SIZE - 1);
+        blank[LOG_RECORD_SIZE - 1] = '\n';
 
         // Write out LOG_MAX_ENTRIES blank records
         for (int i = 0; i < LOG_MAX_ENTRIES; i++) {
-            f.write((uint8_t*)recordBuf, LOG_RECORD_SIZE);
+            f.write(blank, LOG_RECORD_SIZE);
         }
         f.close();
     }
 
     // Open the log file for read/write (no append)
-    logFile = SD.open("player.log", O_RDWR);
-    if (!logFile) return false;
+    if (!logFile.open("player.log", HAL_FILE_RDWR)) return false;
 
-    logIndex = 0;  // start at the beginning of the circular buffer
+    logIndex     = 0;  // start at the beginning of the circular buffer
+    pendingCount = 0;
     return true;
 }
 
 /**
- * @brief Record an event message into the circular log.
+ * @brief Queue an event message for the circular log.
  * 
  * - Builds a fixed-width record: "[timestamp ms] [msg][padding]...\n"
- * - Seeks to the correct offset based on logIndex.
- * - Overwrites the existing record in-place.
- * - Flushes to ensure data is written to the card.
- * - Increments logIndex, wrapping around at LOG_MAX_ENTRIES.
+ *   (the timestamp is taken now, not when the record is written).
+ * - If the queue is full, first writes the oldest record synchronously.
  * 
  * @param msg  Null-terminated short event description.
  */
 void log_event(const char* msg) {
     if (!logFile) return;  // no log file available
 
+    if (pendingCount == LOG_QUEUE_SIZE) log_flush();
+
     // 1) Build the record: zero-padded 10-digit timestamp + space + msg
-    unsigned long t = millis();
-    int n = snprintf(recordBuf, LOG_RECORD_SIZE,
+    char* record = pending[(pendingHead + pendingCount) % LOG_QUEUE_SIZE];
+    unsigned long t = hal_millis();
+    int n = snprintf(record, LOG_RECORD_SIZE,
                      "%010lu %s", t, msg);
     if (n < 0) return;
 
     // 2) Pad the remainder of the record with spaces, leave last byte for '\n'
     if (n < LOG_RECORD_SIZE - 1) {
-        memset(recordBuf + n, ' ', (LOG_RECORD_SIZE - 1) - n);
+        memset(record + n, ' ', (LOG_RECORD_SIZE - 1) - n);
     }
-    recordBuf[LOG_RECORD_SIZE - 1] = '\n';
+    record[LOG_RECORD_SIZE - 1] = '\n';
+    pendingCount++;
+}
 
-    // 3) Compute byte offset in file and write the record there
+/**
+ * @brief Write the oldest queued record to the card.
+ * 
+ * - Seeks to the correct offset based on logIndex.
+ * - Overwrites the existing record in-place.
+ * - Flushes to ensure data is written to the card.
+ * - Increments logIndex, wrapping around at LOG_MAX_ENTRIES.
+ * 
+ * @return false if nothing was queued.
+ */
+bool log_flush(void) {
+    if (pendingCount == 0) return false;
+
+    // Compute byte offset in file and write the record there
     uint32_t offset = (uint32_t)logIndex * LOG_RECORD_SIZE;
     logFile.seek(offset);
-    logFile.write((uint8_t*)recordBuf, LOG_RECORD_SIZE);
+    logFile.write(pending[pendingHead], LOG_RECORD_SIZE);
     logFile.flush();  // ensure immediate write to SD
 
-    // 4) Advance circular index
+    pendingHead = (pendingHead + 1) % LOG_QUEUE_SIZE;
+    pendingCount--;
+
+    // Advance circular index
     logIndex = (logIndex + 1) % LOG_MAX_ENTRIES;
+    return true;
+}
+
+/**
+ * @brief Number of records waiting for log_flush().
+ */
+uint8_t log_pending(void) {
+    return pendingCount;
 }
@@ -0,0 +1,125 @@
+// loop_stats.cpp
+// Per-phase duration statistics for loop().
+
+#include "loop_stats.h"
+
+// --- Static module state ---
+struct PhaseStats {
+    uint32_t count;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint16_t stalls;
+    uint16_t hist[LOOP_STATS_BUCKETS];   // Saturating counts
+};
+
+static PhaseStats stats[LOOP_PHASE_COUNT];
+static uint32_t   phaseStart;
+
+// Most recent stall
+static uint8_t    stallPhase = LOOP_PHASE_COUNT;   // None yet
+static uint32_t   stallUs;
+static uint32_t   stallAtMs;
+
+static const char* const phaseNames[LOOP_PHASE_COUNT] = {
+    "input", "serial", "seek", "player", "gui", "log"
+};
+
+// ----------------------------------------------------------------------------
+// bucketOf(us)
+//   Bit length of us, capped to the last bucket.
+// ----------------------------------------------------------------------------
+static uint8_t bucketOf(uint32_t us) {
+    uint8_t b = 0;
+    while (us && b < LOOP_STATS_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+// ----------------------------------------------------------------------------
+// loop_stats_reset()
+// ----------------------------------------------------------------------------
+void loop_stats_reset(void) {
+    memset(stats, 0, sizeof(stats));
+    for (uint8_t p = 0; p < LOOP_PHASE_COUNT; p++) {
+        stats[p].minUs = UINT32_MAX;
+    }
+    stallPhase = LOOP_PHASE_COUNT;
+    phaseStart = hal_micros();
+}
+
+// ----------------------------------------------------------------------------
+// loop_stats_begin() / loop_stats_end(phase)
+// ----------------------------------------------------------------------------
+void loop_stats_begin(void) {
+    phaseStart = hal_micros();
+}
+
+void loop_stats_end(LoopPhase phase) {
+    uint32_t now = hal_micros();
+    uint32_t us  = now - phaseStart;
+    phaseStart = now;
+    if (phase >= LOOP_PHASE_COUNT) return;
+
+    PhaseStats& s = stats[phase];
+    s.count++;
+    s.totalUs += us;
+    if (us < s.minUs) s.minUs = us;
+    if (us > s.maxUs) s.maxUs = us;
+
+    uint16_t& h = s.hist[bucketOf(us)];
+    if (h != UINT16_MAX) h++;
+
+    if (us >= LOOP_STATS_STALL_US) {
+        if (s.stalls != UINT16_MAX) s.stalls++;
+        stallPhase = phase;
+        stallUs    = us;
+        stallAtMs  = hal_millis();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// loop_stats_dump()
+//   One line per phase, then its histogram as "<lower bound us>:<count>".
+// ----------------------------------------------------------------------------
+void loop_stats_dump(void) {
+    hal_println(F("[LOOP] phase count min_us avg_us max_us stalls"));
+    for (uint8_t p = 0; p < LOOP_PHASE_COUNT; p++) {
+        const PhaseStats& s = stats[p];
+        hal_print(F("[LOOP] "));
+        hal_print(phaseNames[p]);
+        hal_print(F(" "));
+        hal_print(s.count);
+        hal_print(F(" "));
+        hal_print(s.count ? s.minUs : 0);
+        hal_print(F(" "));
+        hal_print(s.count ? (uint32_t)(s.totalUs / s.count) : 0);
+        hal_print(F(" "));
+        hal_print(s.maxUs);
+        hal_print(F(" "));
+        hal_println(s.stalls);
+
+        hal_print(F("[HIST] "));
+        hal_print(phaseNames[p]);
+        for (uint8_t b = 0; b < LOOP_STATS_BUCKETS; b++) {
+            if (s.hist[b] == 0) continue;
+            hal_print(F(" "));
+            hal_print(b ? (uint32_t)1 << (b - 1) : 0);
+            hal_print(F(":"));
+            hal_print(s.hist[b]);
+        }
+        hal_println(F(""));
+    }
+
+    if (stallPhase < LOOP_PHASE_COUNT) {
+        hal_print(F("[LOOP] last stall "));
+        hal_print(phaseNames[stallPhase]);
+        hal_print(F(" "));
+        hal_print(stallUs);
+        hal_print(F(" us at "));
+        hal_print(stallAtMs);
+        hal_println(F(" ms"));
+    }
+}
@@ -0,0 +1,81 @@
+// loop_tasks.cpp
+// Priority-ordered, deadline-aware task pass for loop().
+
+#include "loop_tasks.h"
+
+// ----------------------------------------------------------------------------
+// loop_tasks_init(tasks, count)
+//   Insertion sort; the table is a handful of entries.
+// ----------------------------------------------------------------------------
+void loop_tasks_init(LoopTask* tasks, uint8_t count) {
+    for (uint8_t i = 1; i < count; i++) {
+        LoopTask t = tasks[i];
+        uint8_t  j = i;
+        while (j > 0 && tasks[j - 1].priority < t.priority) {
+            tasks[j] = tasks[j - 1];
+            j--;
+        }
+        tasks[j] = t;
+    }
+    loop_tasks_reset(tasks, count);
+}
+
+// ----------------------------------------------------------------------------
+// loop_tasks_run(tasks, count, headroomUs)
+// ----------------------------------------------------------------------------
+void loop_tasks_run(LoopTask* tasks, uint8_t count, uint32_t headroomUs) {
+    uint32_t passStart = hal_micros();
+    uint32_t nowMs     = hal_millis();
+
+    for (uint8_t i = 0; i < count; i++) {
+        LoopTask& t = tasks[i];
+
+        if (t.maxDeferMs && headroomUs != LOOP_TASKS_NO_DEADLINE) {
+            uint32_t elapsed = hal_micros() - passStart;
+            uint32_t left    = headroomUs > elapsed ? headroomUs - elapsed : 0;
+            if (left < t.budgetUs) {
+                if (nowMs - t.lastRunMs < t.maxDeferMs) {
+                    if (t.deferrals != UINT16_MAX) t.deferrals++;
+                    continue;
+                }
+                if (t.forced != UINT16_MAX) t.forced++;
+            }
+        }
+
+        t.lastRunMs = nowMs;
+        loop_stats_begin();
+        if (t.run(t.budgetUs)) loop_stats_end(t.phase);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// loop_tasks_dump(tasks, count)
+// ----------------------------------------------------------------------------
+void loop_tasks_dump(const LoopTask* tasks, uint8_t count) {
+    hal_println(F("[TASK] name priority budget_us deferrals forced"));
+    for (uint8_t i = 0; i < count; i++) {
+        const LoopTask& t = tasks[i];
+        hal_print(F("[TASK] "));
+        hal_print(t.name);
+        hal_print(F(" "));
+        hal_print(t.priority);
+        hal_print(F(" "));
+        hal_print(t.budgetUs);
+        hal_print(F(" "));
+        hal_print(t.deferrals);
+        hal_print(F(" "));
+        hal_println(t.forced);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// loop_tasks_reset(tasks, count)
+// ----------------------------------------------------------------------------
+void loop_tasks_reset(LoopTask* tasks, uint8_t count) {
+    uint32_t nowMs = hal_millis();
+    for (uint8_t i = 0; i < count; i++) {
+        tasks[i].lastRunMs = nowMs;
+        tasks[i].deferrals = 0;
+        tasks[i].forced    = 0;
+    }
+}
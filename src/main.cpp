@@ -5,15 +5,39 @@
 #include "player.h"     // Playback engine for note events
 #include "oled_gui.h"   // OLED/TFT display interface
 #include "logger.h"     // Event logging to SD card
+#include "seek_index.h" // Time → offset index for fast seeking
+#include "event_queue.h" // Read-ahead queue of parsed note events
+#include "play_clock.h" // Fixed-point song position and tempo
+#include "note_scheduler.h" // Timer-driven note on/off
+#include "loop_stats.h" // Per-phase loop() timing
+#include "onset_trace.h" // Note on/off lateness trace
+#include "loop_tasks.h" // Prioritized, deadline-aware loop() tasks
+#include "buttons.h"    // Debounced, interrupt-sampled buttons
+#include "voices.h"     // Sounding notes and voice allocation
 
 // Pin assignments
+#ifdef PINS_UNO
+#define CHIP_SELECT_PIN    10    // SD card chip select (the 328's SS pin)
+#define BTN_UP_PIN         A0    // UP button (physically bottom of screen)
+#define BTN_OK_PIN         A1    // OK button (middle)
+#define BTN_DOWN_PIN       A2    // DOWN button (physically top of screen)
+#else
 #define CHIP_SELECT_PIN    53    // SD card chip select
 #define BTN_UP_PIN         22    // UP button (physically bottom of screen)
 #define BTN_OK_PIN         23    // OK button (middle)
 #define BTN_DOWN_PIN       24    // DOWN button (physically top of screen)
+#endif
 #define MAX_FILES_COUNT    MAX_FILES
 #define SEEK_BUFFER_DELAY  1000UL  // Delay (ms) for buffered seek to avoid frequent file seeks
 
+// Buttons, indexed as in buttonPins[]
+enum ButtonId {
+  BUTTON_UP,
+  BUTTON_OK,
+  BUTTON_DOWN
+};
+static const uint8_t buttonPins[] = { BTN_UP_PIN, BTN_OK_PIN, BTN_DOWN_PIN };
+
 // Application states
 enum AppState {
   STATE_MENU,     // File selection menu
@@ -27,13 +51,12 @@ static uint8_t selIndex;                 // Index of selected file in list
 static uint8_t fileCount;                // Number of CSV files found on SD
 static const char* fileList[MAX_FILES_COUNT];  // Array of file names
 
-// Playback timing and control variables
-static double        playTime            = 0.0;    // Current playback time (ms)
+// Playback timing and control variables (song position: play_clock.h)
 static unsigned long lastMillis          = 0;      // Timestamp of last update
-static double        tempoFactor         = 1.0;    // Playback speed multiplier
 static long          pendingSeekDeltaMs  = 0;      // Buffered seek offset (ms)
 static unsigned long lastSeekRequestMs    = 0;     // Timestamp of last seek request
 static unsigned long timeSinceLastRefresh = 0;     // Time since last GUI refresh
+static bool          guiDirty            = false;  // Playback screen needs a redraw
 static long          transposeValue      = 0;      // Pitch shift in semitones
 
 // Playback menu options shown on screen
@@ -50,6 +73,28 @@ static char* playbackOpts[] = {
 static const uint8_t playbackCount = sizeof(playbackOpts) / sizeof(playbackOpts[0]);
 static uint8_t playSel = 0;  // Currently highlighted playback option
 
+// loop() tasks, defined below
+static bool audioTask(uint16_t budgetUs);
+static bool seekTask(uint16_t budgetUs);
+static bool inputTask(uint16_t budgetUs);
+static bool telemetryTask(uint16_t budgetUs);
+static bool guiTask(uint16_t budgetUs);
+static bool logTask(uint16_t budgetUs);
+
+// Budgets are typical run times on the board (see the 'l' command): an
+// incremental playback redraw and one SD log write with its flush. A full
+// redraw takes longer and simply waits for a wider gap.
+static LoopTask tasks[] = {
+  // name         run            prio  budget_us  max_defer_ms  phase
+  { "audio",      audioTask,     50,   2000,      0,            LOOP_PHASE_PLAYER },
+  { "input",      inputTask,     40,   0,         0,            LOOP_PHASE_INPUT  },
+  { "seek",       seekTask,      30,   0,         0,            LOOP_PHASE_SEEK   },
+  { "telemetry",  telemetryTask, 20,   0,         0,            LOOP_PHASE_SERIAL },
+  { "gui",        guiTask,       10,   8000,      250,          LOOP_PHASE_GUI    },
+  { "log",        logTask,       0,    10000,     2000,         LOOP_PHASE_LOG    },
+};
+static const uint8_t taskCount = sizeof(tasks) / sizeof(tasks[0]);
+
 // -----------------------------------------------------------------------------
 // setup()
 // Initialize hardware peripherals, load file list, and display initial menu
@@ -62,10 +107,9 @@ void setup() {
   oled_init();
   oled_show_loading();
 
-  // Configure button inputs with internal pull-ups
-  pinMode(BTN_UP_PIN,   INPUT_PULLUP);
-  pinMode(BTN_OK_PIN,   INPUT_PULLUP);
-  pinMode(BTN_DOWN_PIN, INPUT_PULLUP);
+  // Configure button inputs with internal pull-ups; UP/DOWN repeat when held
+  buttons_begin(buttonPins, sizeof(buttonPins),
+                _BV(BUTTON_UP) | _BV(BUTTON_DOWN));
 
   // Initialize SD card and logger
   if (!sd_init(CHIP_SELECT_PIN)) {
@@ -87,10 +131,11 @@ void setup() {
   state               = STATE_MENU;
   selIndex            = 0;
   playSel             = 0;
-  tempoFactor         = 1.0;
-  playTime            = 0.0;
+  play_clock_reset(0);
   pendingSeekDeltaMs  = 0;
   lastSeekRequestMs   = 0;
+  loop_stats_reset();
+  loop_tasks_init(tasks, taskCount);
 
   oled_show_file_list(fileList, fileCount, selIndex);
   log_event("APP START");
@@ -100,211 +145,282 @@ void setup() {
   Serial.println(F("z = rewind 5s, x = forward 5s"));
   Serial.println(F("w/q = tempo +/-, [/] = transpose -/+"));
   Serial.println(F("p = PLAY/PAUSE, s = STOP"));
+  Serial.println(F("l = loop/task timing, L = reset timing"));
+  Serial.println(F("o = onset trace on/off (binary)"));
+  Serial.println(F("c = tone interrupt CPU load"));
 }
 
 // -----------------------------------------------------------------------------
-// loop()
-// Main application loop: update playback time, handle user input, and refresh UI
+// drawPlayback()
+// Redraw the playback screen, showing the position a buffered seek will land on
 // -----------------------------------------------------------------------------
-void loop() {
-  interrupts();  // Ensure timer interrupts for Tone library work correctly
+static void drawPlayback() {
+  oled_show_playback_menu(playbackOpts, playbackCount, playSel,
+                           fileList[selIndex],
+                           (unsigned long)max(0L, (long)play_clock_ms() + pendingSeekDeltaMs),
+                           (state == STATE_PLAYING ? 0 : 1),
+                           play_clock_tempo(), transposeValue);
+  guiDirty             = false;
+  timeSinceLastRefresh = 0;
+}
 
-  // ---------------------------------------------------------------------------
-  // 1) UPDATER
-  //    Update playback time when in PLAYING state
-  // ---------------------------------------------------------------------------
-  if (state == STATE_PLAYING) {
-    unsigned long now = millis();
-    playTime            += (now - lastMillis) * tempoFactor;
-    timeSinceLastRefresh += now - lastMillis;
-    lastMillis = now;
+// -----------------------------------------------------------------------------
+// noteHeadroomUs()
+// Real time until the scheduler next starts or stops a note
+// -----------------------------------------------------------------------------
+static uint32_t noteHeadroomUs() {
+  if (state != STATE_PLAYING) return LOOP_TASKS_NO_DEADLINE;
+
+  unsigned long next;
+  uint8_t irq = hal_irq_save();    // The scheduler interrupt pops the queue
+  bool pending = player_next_deadline(&next);
+  hal_irq_restore(irq);
+  return pending ? play_clock_us_until(next) : LOOP_TASKS_NO_DEADLINE;
+}
+
+// -----------------------------------------------------------------------------
+// audioTask()
+// Keep the event queue filled for the note scheduler interrupt and detect
+// end of song
+// -----------------------------------------------------------------------------
+static bool audioTask(uint16_t budgetUs) {
+  if (state != STATE_PLAYING) return false;
+
+  unsigned long start = micros();
+  while (player_refill(EVENT_QUEUE_SLICE) && micros() - start < budgetUs) {
   }
 
-  // ---------------------------------------------------------------------------
-  // 2) FILE MENU
-  //    Navigate and select CSV files
-  // ---------------------------------------------------------------------------
-  if (state == STATE_MENU) {
-    transposeValue = 0;  // Reset transpose in menu
-
-    static bool lastUp = HIGH, lastOk = HIGH, lastDown = HIGH;
-    bool curUp   = digitalRead(BTN_UP_PIN);
-    bool curOk   = digitalRead(BTN_OK_PIN);
-    bool curDown = digitalRead(BTN_DOWN_PIN);
-
-    // Scroll down (physical bottom of screen)
-    if (lastUp == HIGH && curUp == LOW) {
-      if (selIndex + 1 < fileCount) {
-        selIndex++;
-        oled_show_file_list(fileList, fileCount, selIndex);
-        log_event("Menu DOWN");
-      }
-    }
-    // Scroll up (physical top of screen)
-    if (lastDown == HIGH && curDown == LOW) {
-      if (selIndex > 0) {
-        selIndex--;
-        oled_show_file_list(fileList, fileCount, selIndex);
-        log_event("Menu UP");
-      }
-    }
-    // OK button: open selected file and start playback
-    if (lastOk == HIGH && curOk == LOW) {
-      const char* fn = fileList[selIndex];
-      log_event(strcat("Playing -> ", fn));
-      if (sd_open_file(fn)) {
-        player_init();               // Prepare player state
-        playTime           = 0.0;
-        lastMillis         = millis();
-        state              = STATE_PLAYING;
-        pendingSeekDeltaMs = 0;
-        playSel            = 0;
-        oled_show_playback_menu(playbackOpts, playbackCount, playSel, fn,
-                                 (unsigned long)playTime, 0,
-                                 tempoFactor, transposeValue);
-        timeSinceLastRefresh = 0;
-        log_event("Playback START");
-      } else {
-        oled_show_error("Open failed");
-        log_event("Playback FAIL");
-      }
-    }
+  // if file finished and no active notes, return to menu
+  if (sd_finished() && player_is_idle()) {
+    const SdReadStats* rs = sd_get_read_stats();
+    Serial.print(F("[STAT] events="));
+    Serial.print(rs->events);
+    Serial.print(F(" avg_us="));
+    Serial.print(rs->events ? rs->totalUs / rs->events : 0);
+    Serial.print(F(" max_us="));
+    Serial.print(rs->maxUs);
+    Serial.print(F(" underruns="));
+    Serial.println(event_queue_underruns());
+    note_scheduler_stop();
+    state = STATE_MENU;
+    oled_show_file_list(fileList, fileCount, selIndex);
+    log_event("End of song");
+  }
+  return true;
+}
 
-    // Update last button states for edge detection
-    lastUp   = curUp;
-    lastOk   = curOk;
-    lastDown = curDown;
-    return;  // Skip rest of loop when in menu
+// -----------------------------------------------------------------------------
+// seekTask()
+// Wait a short delay to batch multiple seek requests, then perform actual seek
+// -----------------------------------------------------------------------------
+static bool seekTask(uint16_t) {
+  if (!(state == STATE_PLAYING || state == STATE_PAUSED)
+      || pendingSeekDeltaMs == 0
+      || (millis() - lastSeekRequestMs) < SEEK_BUFFER_DELAY) {
+    return false;
   }
 
-  // ---------------------------------------------------------------------------
-  // 3) PLAYBACK MENU
-  //    Handle Play/Pause, Stop, Seek, Tempo, Transpose
-  // ---------------------------------------------------------------------------
-  if (state == STATE_PLAYING || state == STATE_PAUSED) {
-    static bool lastUp = HIGH, lastOk = HIGH, lastDown = HIGH;
-    bool curUp   = digitalRead(BTN_UP_PIN);
-    bool curOk   = digitalRead(BTN_OK_PIN);
-    bool curDown = digitalRead(BTN_DOWN_PIN);
-
-    // Navigate menu options
-    if (lastDown == HIGH && curDown == LOW) {
-      playSel = (playSel == 0) ? playbackCount - 1 : playSel - 1;
-      oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                               fileList[selIndex], (unsigned long)playTime,
-                               (state == STATE_PLAYING ? 0 : 1),
-                               tempoFactor, transposeValue);
-      timeSinceLastRefresh = 0;
+  // compute new playback time, clamp to zero
+  long nt = (long)play_clock_ms() + pendingSeekDeltaMs;
+  nt = (nt < 0) ? 0 : nt;
+
+  // re-position in file and resume at newTime
+  note_scheduler_stop();
+  player_seek((unsigned long)nt * 1000UL, fileList[selIndex]);
+  play_clock_set((uint32_t)nt * 1000UL);
+  if (state == STATE_PLAYING) note_scheduler_start();
+  pendingSeekDeltaMs = 0;
+  log_event("Executed seek");
+
+  // refresh playback menu to reflect new position
+  guiDirty = true;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// menuInput()
+// Navigate and select CSV files
+// -----------------------------------------------------------------------------
+static void menuInput(const ButtonEvent& ev) {
+  // Scroll down (physical bottom of screen)
+  if (ev.button == BUTTON_UP) {
+    if (selIndex + 1 < fileCount) {
+      selIndex++;
+      oled_show_file_list(fileList, fileCount, selIndex);
+      log_event("Menu DOWN");
+    }
+  }
+  // Scroll up (physical top of screen)
+  if (ev.button == BUTTON_DOWN) {
+    if (selIndex > 0) {
+      selIndex--;
+      oled_show_file_list(fileList, fileCount, selIndex);
+      log_event("Menu UP");
     }
-    if (lastUp == HIGH && curUp == LOW) {
-      playSel = (playSel + 1) % playbackCount;
-      oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                               fileList[selIndex], (unsigned long)playTime,
-                               (state == STATE_PLAYING ? 0 : 1),
-                               tempoFactor, transposeValue);
+  }
+  // OK button: open selected file and start playback
+  if (ev.button == BUTTON_OK) {
+    const char* fn = fileList[selIndex];
+    log_event(strcat("Playing -> ", fn));
+    if (sd_open_file(fn)) {
+      oled_show_loading();
+      if (!seek_index_prepare(fn)) {   // Build/open seek index (may scan once)
+        log_event("No seek index");
+      }
+      const SongInfo* info = sd_get_song_info();
+      if (info->eventCount) {      // Metadata from a binary song header
+        Serial.print(F("[SONG] events="));
+        Serial.print(info->eventCount);
+        Serial.print(F(" duration_ms="));
+        Serial.print(info->duration / 1000);
+        Serial.print(F(" polyphony="));
+        Serial.println(info->maxPolyphony);
+      }
+      if (info->maxPolyphony > NUM_BUZZERS) {
+        log_event("Polyphony exceeds buzzers");
+      }
+      player_init();               // Prepare player state
+      onset_trace_song(fn);
+      play_clock_reset(0);
+      play_clock_resume();
+      note_scheduler_start();      // Notes now play from the timer interrupt
+      lastMillis         = millis();
+      state              = STATE_PLAYING;
+      pendingSeekDeltaMs = 0;
+      playSel            = 0;
+      guiDirty           = true;
       timeSinceLastRefresh = 0;
+      log_event("Playback START");
+    } else {
+      oled_show_error("Open failed");
+      log_event("Playback FAIL");
     }
+  }
+}
 
-    // Execute selected action on OK (only if playback has started)
-    if (lastOk == HIGH && curOk == LOW && playTime > 0.5) {
-      switch (playSel) {
-        case 0:  // Play/Pause toggle
-          if (state == STATE_PLAYING) {
-            player_stop_all();  // Pause by stopping buzzers
-            state = STATE_PAUSED;
-            log_event("Paused");
-          } else {
-            lastMillis = millis();
-            state      = STATE_PLAYING;
-            log_event("Resumed");
-          }
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex], (unsigned long)playTime,
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
-
-        case 1:  // Stop playback and return to file menu
-          player_stop_all();
-          state = STATE_MENU;
-          oled_show_file_list(fileList, fileCount, selIndex);
-          log_event("Stopped");
-          break;
-
-        case 2:  // Fast-forward 5 seconds
-          playTime   += 5000.0;
-          lastMillis  = millis();
-          player_stop_all();
-          Serial.println(F("[CMD] Forward 5s"));
-          log_event("Forward 5s");
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex], (unsigned long)playTime,
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
-
-        case 3:  // Rewind 5 seconds (buffered)
-          pendingSeekDeltaMs -= 5000;
-          if ((unsigned long)playTime < 5000) pendingSeekDeltaMs = -(unsigned long)playTime;
-          lastSeekRequestMs  = millis();
-          log_event("Rewind 5s");
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex],
-                                   (unsigned long)max(0.0, playTime + pendingSeekDeltaMs),
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
+// -----------------------------------------------------------------------------
+// playbackInput()
+// Handle Play/Pause, Stop, Seek, Tempo, Transpose
+// -----------------------------------------------------------------------------
+static void playbackInput(const ButtonEvent& ev) {
+  // Navigate menu options
+  if (ev.button == BUTTON_DOWN) {
+    playSel = (playSel == 0) ? playbackCount - 1 : playSel - 1;
+    guiDirty = true;
+  }
+  if (ev.button == BUTTON_UP) {
+    playSel = (playSel + 1) % playbackCount;
+    guiDirty = true;
+  }
 
-        case 4:  // Increase speed
-          tempoFactor += 0.1;
-          log_event("Speed +0.1");
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex], (unsigned long)playTime,
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
+  // Execute selected action on OK (only if playback has started)
+  if (ev.button == BUTTON_OK && play_clock_ms() > 0) {
+    switch (playSel) {
+      case 0:  // Play/Pause toggle
+        if (state == STATE_PLAYING) {
+          note_scheduler_stop();
+          player_stop_all();  // Pause by stopping buzzers
+          play_clock_pause();
+          state = STATE_PAUSED;
+          log_event("Paused");
+        } else {
+          play_clock_resume();
+          note_scheduler_start();
+          lastMillis = millis();
+          state      = STATE_PLAYING;
+          log_event("Resumed");
+        }
+        guiDirty = true;
+        break;
+
+      case 1:  // Stop playback and return to file menu
+        note_scheduler_stop();
+        player_stop_all();
+        state = STATE_MENU;
+        oled_show_file_list(fileList, fileCount, selIndex);
+        log_event("Stopped");
+        break;
 
-        case 5:  // Decrease speed
-          tempoFactor = max(0.1, tempoFactor - 0.1);
-          log_event("Speed -0.1");
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex], (unsigned long)playTime,
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
+      case 2:  // Fast-forward 5 seconds
+        note_scheduler_stop();
+        play_clock_set(play_clock_us() + 5000000UL);
+        player_stop_all();
+        if (state == STATE_PLAYING) note_scheduler_start();
+        Serial.println(F("[CMD] Forward 5s"));
+        log_event("Forward 5s");
+        guiDirty = true;
+        break;
 
-        case 6:  // Transpose up one semitone
-          transposeValue++;
-          player_modify_transpose(+1);
-          log_event("Transpose +1");
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex], (unsigned long)playTime,
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
+      case 3:  // Rewind 5 seconds (buffered)
+        pendingSeekDeltaMs -= 5000;
+        if (play_clock_ms() < 5000) pendingSeekDeltaMs = -(long)play_clock_ms();
+        lastSeekRequestMs  = millis();
+        log_event("Rewind 5s");
+        guiDirty = true;
+        break;
+
+      case 4:  // Increase speed
+        play_clock_set_tempo(play_clock_tempo() + PLAY_CLOCK_TEMPO_STEP);
+        note_scheduler_rearm();
+        log_event("Speed +10%");
+        guiDirty = true;
+        break;
+
+      case 5:  // Decrease speed
+        play_clock_set_tempo(play_clock_tempo() - PLAY_CLOCK_TEMPO_STEP);
+        note_scheduler_rearm();
+        log_event("Speed -10%");
+        guiDirty = true;
+        break;
+
+      case 6:  // Transpose up one semitone
+        transposeValue++;
+        player_modify_transpose(+1);
+        log_event("Transpose +1");
+        guiDirty = true;
+        break;
 
-        case 7:  // Transpose down one semitone
-          transposeValue--;
-          player_modify_transpose(-1);
-          log_event("Transpose -1");
-          oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex], (unsigned long)playTime,
-                                   (state == STATE_PLAYING ? 0 : 1),
-                                   tempoFactor, transposeValue);
-          break;
-      }
+      case 7:  // Transpose down one semitone
+        transposeValue--;
+        player_modify_transpose(-1);
+        log_event("Transpose -1");
+        guiDirty = true;
+        break;
     }
+  }
+}
 
-    // Save button states for next cycle
-    lastUp   = curUp;
-    lastOk   = curOk;
-    lastDown = curDown;
+// -----------------------------------------------------------------------------
+// inputTask()
+// Handle the presses queued by the button interrupt since the last pass
+// -----------------------------------------------------------------------------
+static bool inputTask(uint16_t) {
+  if (state == STATE_MENU) transposeValue = 0;  // Reset transpose in menu
+
+  ButtonEvent ev;
+  bool        any = false;
+  while (buttons_pop(&ev)) {
+    if (state == STATE_MENU) {
+      menuInput(ev);
+    } else {
+      playbackInput(ev);
+    }
+    any = true;
   }
-  // ---------------------------------------------------------------------------
-  // 4) SERIAL COMMANDS
-  //    Handle single-character commands over the Serial port for playback control
-  // ---------------------------------------------------------------------------
+  return any;
+}
+
+// -----------------------------------------------------------------------------
+// telemetryTask()
+// Handle single-character commands over the Serial port for playback control,
+// and stream out note timing records as far as the serial buffer allows
+// -----------------------------------------------------------------------------
+static bool telemetryTask(uint16_t) {
+  if (state == STATE_MENU) return false;
+
+  bool busy = onset_trace_enabled();
   if (Serial.available()) {
+    busy = true;
     char cmd = Serial.read();
     // ignore carriage returns / newlines
     if (cmd != '\n' && cmd != '\r') {
@@ -313,18 +429,16 @@ void loop() {
         case STATE_PLAYING:
           if (cmd == 'p') {
             // Pause playback immediately
+            note_scheduler_stop();
             player_stop_all();
+            play_clock_pause();
             state = STATE_PAUSED;
-            oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex],
-                                   (unsigned long)playTime,
-                                   /* status= */1,
-                                   tempoFactor,
-                                   transposeValue);
+            guiDirty = true;
             log_event("Paused");
           }
           else if (cmd == 's') {
             // Stop and return to file menu
+            note_scheduler_stop();
             player_stop_all();
             state = STATE_MENU;
             oled_show_file_list(fileList, fileCount, selIndex);
@@ -335,19 +449,16 @@ void loop() {
         case STATE_PAUSED:
           if (cmd == 'p') {
             // Resume playback
+            play_clock_resume();
+            note_scheduler_start();
             lastMillis = millis();
             state      = STATE_PLAYING;
-            timeSinceLastRefresh = 0;
-            oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                                   fileList[selIndex],
-                                   (unsigned long)playTime,
-                                   /* status= */0,
-                                   tempoFactor,
-                                   transposeValue);
+            guiDirty   = true;
             log_event("Resumed");
           }
           else if (cmd == 's') {
             // Stop and go back to menu
+            note_scheduler_stop();
             player_stop_all();
             state = STATE_MENU;
             oled_show_file_list(fileList, fileCount, selIndex);
@@ -369,23 +480,26 @@ void loop() {
       }
       // fast-forward 5s (immediate)
       if (cmd == 'x') {
-        playTime   += 5000.0;
-        lastMillis  = millis();
+        note_scheduler_stop();
+        play_clock_set(play_clock_us() + 5000000UL);
         player_stop_all();
+        if (state == STATE_PLAYING) note_scheduler_start();
         Serial.println(F("[CMD] Forward 5s"));
         log_event("Forward 5s");
       }
 
       // tempo adjustment
       if (cmd == 'w') {
-        tempoFactor += 0.1;
-        Serial.print(F("[CMD] Tempo+ → ")); Serial.println(tempoFactor);
-        log_event("Tempo +0.1");
+        play_clock_set_tempo(play_clock_tempo() + PLAY_CLOCK_TEMPO_STEP);
+        note_scheduler_rearm();
+        Serial.print(F("[CMD] Tempo+ → ")); Serial.print(play_clock_tempo()); Serial.println('%');
+        log_event("Tempo +10%");
       }
       if (cmd == 'q') {
-        tempoFactor = max(0.1, tempoFactor - 0.1);
-        Serial.print(F("[CMD] Tempo- → ")); Serial.println(tempoFactor);
-        log_event("Tempo -0.1");
+        play_clock_set_tempo(play_clock_tempo() - PLAY_CLOCK_TEMPO_STEP);
+        note_scheduler_rearm();
+        Serial.print(F("[CMD] Tempo- → ")); Serial.print(play_clock_tempo()); Serial.println('%');
+        log_event("Tempo -10%");
       }
 
       // transpose adjustment
@@ -401,60 +515,93 @@ void loop() {
         Serial.println(F("[CMD] Transpose-"));
         log_event("Transpose -1");
       }
+
+      // loop() phase timing
+      if (cmd == 'l') {
+        loop_stats_dump();
+        loop_tasks_dump(tasks, taskCount);
+        const OledStats* gs = oled_get_stats();
+        Serial.print(F("[GUI] frames="));
+        Serial.print(gs->frames);
+        Serial.print(F(" last_bytes="));
+        Serial.print(gs->lastBytes);
+        Serial.print(F(" max_bytes="));
+        Serial.print(gs->maxBytes);
+        Serial.print(F(" avg_bytes="));
+        Serial.println(gs->frames ? gs->totalBytes / gs->frames : 0);
+        Serial.print(F("[BTN] dropped="));
+        Serial.println(buttons_dropped());
+        Serial.print(F("[VOICE] preempted="));
+        Serial.println(voices_preempted());
+      }
+      if (cmd == 'L') {
+        loop_stats_reset();
+        loop_tasks_reset(tasks, taskCount);
+        Serial.println(F("[CMD] Loop timing reset"));
+      }
+
+      // tone interrupt load
+      if (cmd == 'c') {
+        hal_tone_dump_load();
+      }
+
+      // note onset trace
+      if (cmd == 'o') {
+        if (onset_trace_enabled()) {
+          onset_trace_flush(true);
+          Serial.print(F("[TRACE] off dropped="));
+          Serial.println(onset_trace_dropped());
+          onset_trace_enable(false);
+        } else {
+          onset_trace_enable(true);
+          Serial.println(F("[TRACE] on"));
+          onset_trace_song(fileList[selIndex]);
+        }
+      }
     }
   }
 
-  // ---------------------------------------------------------------------------
-  // 5) BUFFERED SEEK
-  //    Wait a short delay to batch multiple seek requests, then perform actual seek
-  // ---------------------------------------------------------------------------
-  if ((state == STATE_PLAYING || state == STATE_PAUSED)
-      && pendingSeekDeltaMs != 0
-      && (millis() - lastSeekRequestMs) >= SEEK_BUFFER_DELAY) {
-    // compute new playback time, clamp to zero
-    double nt = playTime + pendingSeekDeltaMs;
-    nt = (nt < 0.0) ? 0.0 : nt;
-
-    // re-position in file and resume at newTime
-    player_seek((unsigned long)nt, fileList[selIndex]);
-    playTime           = nt;
-    lastMillis         = millis();
-    pendingSeekDeltaMs = 0;
-    log_event("Executed seek");
-
-    // refresh playback menu to reflect new position
-    oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                           fileList[selIndex],
-                           (unsigned long)playTime,
-                           (state == STATE_PLAYING ? 0 : 1),
-                           tempoFactor,
-                           transposeValue);
+  onset_trace_flush(false);
+  return busy;
+}
+
+// -----------------------------------------------------------------------------
+// guiTask()
+// Redraw the playback screen when something changed, or every ~9 seconds
+// while playing to advance the clock
+// -----------------------------------------------------------------------------
+static bool guiTask(uint16_t) {
+  if (state == STATE_MENU) return false;
+  if (!guiDirty && !(state == STATE_PLAYING && timeSinceLastRefresh > 9000)) {
+    return false;
   }
+  drawPlayback();
+  return true;
+}
 
-  // ---------------------------------------------------------------------------
-  // 6) PLAYER UPDATE LOOP
-  //    Drive the playback engine and detect end of song
-  // ---------------------------------------------------------------------------
-  if (state == STATE_PLAYING) {
-    // feed next note events to buzzers
-    player_update((unsigned long)playTime);
-
-    // periodically refresh UI (every ~9 seconds)
-    if (timeSinceLastRefresh > 9000) {
-      oled_show_playback_menu(playbackOpts, playbackCount, playSel,
-                             fileList[selIndex],
-                             (unsigned long)playTime,
-                             /* status= */0,
-                             tempoFactor,
-                             transposeValue);
-      timeSinceLastRefresh = 0;
-    }
+// -----------------------------------------------------------------------------
+// logTask()
+// Write one queued log record to the SD card
+// -----------------------------------------------------------------------------
+static bool logTask(uint16_t) {
+  return log_flush();
+}
 
-    // if file finished and no active notes, return to menu
-    if (sd_finished() && player_is_idle()) {
-      state = STATE_MENU;
-      oled_show_file_list(fileList, fileCount, selIndex);
-      log_event("End of song");
-    }
+// -----------------------------------------------------------------------------
+// loop()
+// Main application loop: update playback time, then run the tasks. Redraws
+// and log writes are held back while the next note is due too soon.
+// -----------------------------------------------------------------------------
+void loop() {
+  interrupts();  // Ensure timer interrupts for Tone library work correctly
+
+  // Update playback time when in PLAYING state
+  if (state == STATE_PLAYING) {
+    unsigned long now = millis();
+    play_clock_update();
+    timeSinceLastRefresh += now - lastMillis;
+    lastMillis = now;
   }
+
+  loop_tasks_run(tasks, taskCount, noteHeadroomUs());
 }
@@ -0,0 +1,308 @@
+// bench.cpp (native, env:native_bench)
+// Throughput benchmarks for the playback hot paths.
+//
+// Generates synthetic songs (CSV, fixed and delta binary) with a chosen number of events,
+// polyphony and note density, then measures events per second through
+// sd_read_next_event(), player_update() and player_seek(). Each result is
+// printed as one JSON object per line so runs can be diffed or plotted.
+//
+// Usage: buzzer_bench [-n 1000,10000,...] [-p polyphony] [-r notes_per_sec]
+//                     [-s seeks] [-d work_dir]
+
+#if !defined(ARDUINO) && defined(BENCHMARK)
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "hal_native.h"
+#include "sd_card.h"
+#include "song_format.h"
+#include "seek_index.h"
+#include "event_queue.h"
+#include "player.h"
+#include "pitch.h"
+
+// Benchmark parameters shared by every run
+struct BenchConfig {
+  uint8_t  polyphony;     // Simultaneous notes (1..NUM_BUZZERS)
+  uint32_t density;       // Note onsets per second of song time
+  uint32_t seeks;         // Indexed seeks per run
+  uint32_t rescanSeeks;   // Unindexed (full rescan) seeks per run
+};
+
+static double nowSeconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Small deterministic LCG so every run sees the same songs
+static uint32_t rngState;
+static uint32_t rng(void) {
+  rngState = rngState * 1664525UL + 1013904223UL;
+  return rngState >> 8;
+}
+
+// -----------------------------------------------------------------------------
+// makeEvent(i, cfg, e)
+//   Event i of the synthetic song: onsets every 1000/density ms with ±25%
+//   jitter, buzzers assigned round-robin over `polyphony` voices, and each
+//   note lasting about polyphony onsets so the voices overlap.
+// -----------------------------------------------------------------------------
+static void makeEvent(uint32_t i, const BenchConfig& cfg, uint32_t* clock,
+                      NoteEvent* e) {
+  uint32_t gap = 1000 / cfg.density;
+  if (gap == 0) gap = 1;
+  if (i > 0) *clock += gap - gap / 4 + rng() % (gap / 2 + 1);
+  e->note      = 36 + rng() % 60;
+  e->startTime = *clock;
+  e->endTime   = *clock + gap * cfg.polyphony - gap / 4;
+  e->buzzer    = 1 + i % cfg.polyphony;
+}
+
+// -----------------------------------------------------------------------------
+// putVarint(f, v)
+//   Append v as an unsigned LEB128 varint.
+// -----------------------------------------------------------------------------
+static void putVarint(FILE* f, uint32_t v) {
+  while (v >= 0x80) {
+    fputc((int)(v & 0x7F) | 0x80, f);
+    v >>= 7;
+  }
+  fputc((int)v, f);
+}
+
+// -----------------------------------------------------------------------------
+// writeSongs(dir, events, cfg, songMs)
+//   Write BENCH.CSV, BENCH.BZS (fixed records) and BENCHD.BZS (delta
+//   records) holding the same synthetic events.
+// -----------------------------------------------------------------------------
+static bool writeSongs(const char* dir, uint32_t events, const BenchConfig& cfg,
+                       uint32_t* songMs) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/BENCH.CSV", dir);
+  FILE* csv = fopen(path, "wb");
+  snprintf(path, sizeof(path), "%s/BENCH.BZS", dir);
+  FILE* bin = fopen(path, "wb");
+  snprintf(path, sizeof(path), "%s/BENCHD.BZS", dir);
+  FILE* dlt = fopen(path, "wb");
+  if (!csv || !bin || !dlt) return false;
+
+  SongHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, SONG_MAGIC, SONG_MAGIC_LEN);
+  hdr.version    = SONG_VERSION;
+  hdr.format     = SONG_FMT_FIXED;
+  hdr.headerSize = sizeof(SongHeader);
+  hdr.eventCount   = events;
+  hdr.maxPolyphony = cfg.polyphony;
+  hdr.tickUs       = 1000;
+  fwrite(&hdr, sizeof(hdr), 1, bin);
+  hdr.format     = SONG_FMT_DELTA;
+  fwrite(&hdr, sizeof(hdr), 1, dlt);
+  fprintf(csv, "note,frequency,start_ms,end_ms,buzzer\n");
+
+  rngState = 12345;
+  uint32_t clock = 0, prevStart = 0;
+  NoteEvent e;
+  for (uint32_t i = 0; i < events; i++) {
+    makeEvent(i, cfg, &clock, &e);
+    uint16_t hz = pitch_note_to_hz(e.note);
+    fprintf(csv, "%lu,%u,%lu,%lu,%u\n", (unsigned long)i, hz,
+            (unsigned long)e.startTime, (unsigned long)e.endTime, e.buzzer);
+
+    uint8_t  rec[SONG_RECORD_SIZE];
+    uint32_t st = e.startTime, et = e.endTime;
+    rec[0]  = hz;  rec[1] = hz >> 8;
+    rec[2]  = st;  rec[3] = st >> 8;  rec[4] = st >> 16;  rec[5] = st >> 24;
+    rec[6]  = et;  rec[7] = et >> 8;  rec[8] = et >> 16;  rec[9] = et >> 24;
+    rec[10] = e.buzzer;
+    fwrite(rec, sizeof(rec), 1, bin);
+
+    putVarint(dlt, st - prevStart);
+    putVarint(dlt, et - st);
+    fputc(e.note, dlt);
+    fputc(e.buzzer, dlt);
+    prevStart = st;
+  }
+  *songMs = (uint32_t)e.endTime;
+
+  fclose(csv);
+  fclose(bin);
+  fclose(dlt);
+  return true;
+}
+
+static void report(const char* bench, const char* song, uint32_t events,
+                   const BenchConfig& cfg, uint32_t ops, double secs) {
+  HalFile f;
+  uint32_t bytes = f.open(song, HAL_FILE_READ) ? f.size() : 0;
+  f.close();
+  printf("{\"bench\":\"%s\",\"song\":\"%s\",\"events\":%lu,\"polyphony\":%u,"
+         "\"density\":%lu,\"file_bytes\":%lu,\"bytes_per_event\":%.2f,"
+         "\"ops\":%lu,\"seconds\":%.6f,\"ops_per_sec\":%.1f,\"us_per_op\":%.4f}\n",
+         bench, song, (unsigned long)events, cfg.polyphony,
+         (unsigned long)cfg.density, (unsigned long)bytes,
+         events ? (double)bytes / events : 0.0, (unsigned long)ops, secs,
+         secs > 0 ? ops / secs : 0.0, ops ? secs * 1e6 / ops : 0.0);
+  fflush(stdout);
+}
+
+// -----------------------------------------------------------------------------
+// benchParse(song)
+//   Events per second through sd_read_next_event() alone.
+// -----------------------------------------------------------------------------
+static void benchParse(const char* song, uint32_t events, const BenchConfig& cfg) {
+  NoteEvent e;
+  uint32_t  n = 0;
+  sd_open_file(song);
+  double t0 = nowSeconds();
+  while (sd_read_next_event(&e)) n++;
+  report("parse", song, events, cfg, n, nowSeconds() - t0);
+}
+
+// -----------------------------------------------------------------------------
+// benchUpdate(song)
+//   Events per second through player_update() + player_refill(), driving
+//   the song clock in 1 ms steps.
+// -----------------------------------------------------------------------------
+static void benchUpdate(const char* song, uint32_t events, const BenchConfig& cfg) {
+  sd_open_file(song);
+  seek_index_close();
+  player_init();
+  uint32_t t = 0;
+  double t0 = nowSeconds();
+  while (!(sd_finished() && player_is_idle())) {
+    player_update(t);
+    t += 1000;
+    player_refill(EVENT_QUEUE_SLICE);
+  }
+  report("update", song, events, cfg, events, nowSeconds() - t0);
+  if (event_queue_underruns()) {
+    fprintf(stderr, "warning: %u queue underruns\n", event_queue_underruns());
+  }
+}
+
+// -----------------------------------------------------------------------------
+// benchSeek(song, songMs)
+//   player_seek() calls per second to random times, with and without the
+//   seek index.
+// -----------------------------------------------------------------------------
+static void benchSeek(const char* song, uint32_t events, const BenchConfig& cfg,
+                      uint32_t songMs) {
+  sd_open_file(song);
+  seek_index_prepare(song);
+  player_init();
+
+  rngState = 777;
+  double t0 = nowSeconds();
+  for (uint32_t i = 0; i < cfg.seeks; i++) {
+    player_seek((rng() % (songMs + 1)) * 1000UL, song);
+  }
+  report("seek_indexed", song, events, cfg, cfg.seeks, nowSeconds() - t0);
+
+  seek_index_close();
+  t0 = nowSeconds();
+  for (uint32_t i = 0; i < cfg.rescanSeeks; i++) {
+    player_seek((rng() % (songMs + 1)) * 1000UL, song);
+  }
+  report("seek_rescan", song, events, cfg, cfg.rescanSeeks, nowSeconds() - t0);
+  player_stop_all();
+}
+
+// -----------------------------------------------------------------------------
+// removeScratch(dir, songs, count)
+//   Delete the generated songs, their seek indexes and the mkdtemp directory.
+// -----------------------------------------------------------------------------
+static void removeScratch(const char* dir, const char* const* songs, size_t count) {
+  seek_index_close();
+  for (size_t i = 0; i < count; i++) {
+    char indexName[MAX_FN_LEN];
+    seek_index_name(songs[i], indexName);
+    hal_fs_remove(indexName);
+    hal_fs_remove(songs[i]);
+  }
+  if (rmdir(dir) != 0) perror(dir);
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+          "Usage: %s [-n counts] [-p polyphony] [-r density] [-s seeks] [-d dir]\n"
+          "  -n LIST  comma-separated event counts (default 1000,10000,100000,1000000)\n"
+          "  -p N     simultaneous notes, 1..%u (default 4)\n"
+          "  -r N     note onsets per second of song time (default 20)\n"
+          "  -s N     indexed seeks per song (default 200)\n"
+          "  -d DIR   directory for generated songs, kept afterwards\n"
+          "           (default: a mkdtemp directory, removed at exit)\n",
+          prog, NUM_BUZZERS);
+}
+
+int main(int argc, char** argv) {
+  BenchConfig cfg = { 4, 20, 200, 5 };
+  const char* counts = "1000,10000,100000,1000000";
+  char        dir[256] = "";
+  bool        scratch  = false;   // dir came from mkdtemp: remove it at exit
+  int         opt;
+
+  while ((opt = getopt(argc, argv, "n:p:r:s:d:h")) != -1) {
+    switch (opt) {
+      case 'n': counts        = optarg;                 break;
+      case 'p': cfg.polyphony = (uint8_t)atoi(optarg);  break;
+      case 'r': cfg.density   = (uint32_t)atol(optarg); break;
+      case 's': cfg.seeks     = (uint32_t)atol(optarg); break;
+      case 'd': snprintf(dir, sizeof(dir), "%s", optarg); break;
+      default:  usage(argv[0]); return 1;
+    }
+  }
+  if (cfg.polyphony < 1 || cfg.polyphony > NUM_BUZZERS || cfg.density < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (!dir[0]) {
+    snprintf(dir, sizeof(dir), "/tmp/buzzer_bench_XXXXXX");
+    if (!mkdtemp(dir)) {
+      perror("mkdtemp");
+      return 1;
+    }
+    scratch = true;
+  }
+
+  // Keep stdout pure JSON: diagnostics from the core go to stderr
+  hal_native_set_root(dir);
+  hal_native_set_console(stderr);
+  hal_native_set_tone_trace(false);
+
+  const char* songs[] = { "BENCH.CSV", "BENCH.BZS", "BENCHD.BZS" };
+  const size_t songCount = sizeof(songs) / sizeof(songs[0]);
+  if (!sd_init(0)) {
+    fprintf(stderr, "cannot use %s\n", dir);
+    if (scratch) rmdir(dir);
+    return 1;
+  }
+
+  int status = 0;
+  for (const char* p = counts; *p; ) {
+    uint32_t events = (uint32_t)strtoul(p, (char**)&p, 10);
+    if (*p == ',') p++;
+    if (events == 0) continue;
+
+    uint32_t songMs;
+    if (!writeSongs(dir, events, cfg, &songMs)) {
+      fprintf(stderr, "cannot write songs to %s\n", dir);
+      status = 1;
+      break;
+    }
+    for (const char* song : songs) {
+      char indexName[MAX_FN_LEN];         // build a fresh index per song
+      seek_index_name(song, indexName);
+      hal_fs_remove(indexName);
+      benchParse(song, events, cfg);
+      benchUpdate(song, events, cfg);
+      benchSeek(song, events, cfg, songMs);
+    }
+  }
+  if (scratch) removeScratch(dir, songs, songCount);
+  return status;
+}
+
+#endif // !ARDUINO && BENCHMARK
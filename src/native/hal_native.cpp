@@ -0,0 +1,281 @@
+// hal_native.cpp
+// HAL implementation for the host (env:native): POSIX clock, stdio console,
+// a directory standing in for the SD card, and silent tone voices whose
+// state can be inspected or traced.
+
+#ifndef ARDUINO
+
+#include "hal_native.h"
+#include "pitch.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// Host directory used as the SD card root
+static char rootDir[256] = ".";
+
+// Per-voice state of the simulated buzzers
+static uint16_t toneFreq[HAL_MAX_VOICES];
+static bool     toneTrace = false;
+
+// Stream backing hal_print()/hal_println()
+static FILE* console = stdout;
+
+// Clock origin, so the counters start near zero like on the board
+static uint64_t startUs = 0;
+
+// Scheduler timer, polled by hal_native_timer_poll()
+static HalTimerCallback timerFn;
+static uint32_t         timerAt;
+static bool             timerArmed = false;
+static HalTimerCallback tickFn;
+
+// -----------------------------------------------------------------------------
+// resolvePath(path, out)
+//   Map an SD path ("/x.csv" or "x.csv") into rootDir.
+// -----------------------------------------------------------------------------
+static void resolvePath(const char* path, char* out, size_t len) {
+    while (*path == '/') path++;
+    snprintf(out, len, "%s/%s", rootDir, path);
+}
+
+static uint64_t monotonicUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// -----------------------------------------------------------------------------
+// Host-only configuration
+// -----------------------------------------------------------------------------
+void hal_native_set_root(const char* dir) {
+    snprintf(rootDir, sizeof(rootDir), "%s", dir);
+}
+
+void hal_native_set_console(FILE* out) {
+    console = out;
+}
+
+void hal_native_set_tone_trace(bool enabled) {
+    toneTrace = enabled;
+}
+
+uint16_t hal_native_tone_frequency(uint8_t voice) {
+    return voice < HAL_MAX_VOICES ? toneFreq[voice] : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Clock
+// -----------------------------------------------------------------------------
+uint32_t hal_micros(void) {
+    if (startUs == 0) startUs = monotonicUs();
+    return (uint32_t)(monotonicUs() - startUs);
+}
+
+uint32_t hal_millis(void) {
+    if (startUs == 0) startUs = monotonicUs();
+    return (uint32_t)((monotonicUs() - startUs) / 1000);
+}
+
+void hal_enable_interrupts(void) {
+}
+
+uint8_t hal_irq_save(void) {
+    return 0;
+}
+
+void hal_irq_restore(uint8_t state) {
+    (void)state;
+}
+
+// -----------------------------------------------------------------------------
+// Scheduler timer (polled)
+// -----------------------------------------------------------------------------
+void hal_timer_begin(HalTimerCallback fn) {
+    timerFn    = fn;
+    timerArmed = false;
+}
+
+void hal_timer_arm(uint32_t delayUs) {
+    timerAt    = hal_micros() + delayUs;
+    timerArmed = true;
+}
+
+void hal_timer_disarm(void) {
+    timerArmed = false;
+}
+
+void hal_tick_begin(HalTimerCallback fn) {
+    tickFn = fn;
+}
+
+void hal_native_timer_poll(void) {
+    if (tickFn) tickFn();
+    if (timerArmed && (int32_t)(hal_micros() - timerAt) >= 0) {
+        timerArmed = false;
+        timerFn();
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Input pins (no buttons on the host: every pin reads released)
+// -----------------------------------------------------------------------------
+void hal_input_begin(uint8_t pin) {
+    (void)pin;
+}
+
+bool hal_input_read(uint8_t pin) {
+    (void)pin;
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// Console (stdout unless redirected)
+// -----------------------------------------------------------------------------
+void hal_print(const char* s)   { fputs(s, console); }
+void hal_print(uint32_t v)      { fprintf(console, "%lu", (unsigned long)v); }
+void hal_println(const char* s) { fprintf(console, "%s\n", s); }
+void hal_println(uint32_t v)    { fprintf(console, "%lu\n", (unsigned long)v); }
+
+size_t hal_write(const void* buf, size_t len) {
+    return fwrite(buf, 1, len, console);
+}
+
+// stdio buffers as much as needed
+size_t hal_write_room(void) {
+    return SIZE_MAX;
+}
+
+// -----------------------------------------------------------------------------
+// Tone output (simulated)
+// -----------------------------------------------------------------------------
+void hal_tone_begin(uint8_t voice, uint8_t pin) {
+    if (voice < HAL_MAX_VOICES) {
+        toneFreq[voice] = 0;
+        if (toneTrace) printf("[tone] voice %u -> pin %u\n", voice, pin);
+    }
+}
+
+void hal_tone_play(uint8_t voice, uint16_t frequency) {
+    if (voice < HAL_MAX_VOICES) {
+        toneFreq[voice] = frequency;
+        if (toneTrace) printf("[tone] %10lu us  on  %u %5u Hz\n",
+                              (unsigned long)hal_micros(), voice, frequency);
+    }
+}
+
+void hal_tone_play_note(uint8_t voice, uint8_t note) {
+    hal_tone_play(voice, pitch_note_to_hz(note));
+}
+
+void hal_tone_stop(uint8_t voice) {
+    if (voice < HAL_MAX_VOICES) {
+        toneFreq[voice] = 0;
+        if (toneTrace) printf("[tone] %10lu us  off %u\n",
+                              (unsigned long)hal_micros(), voice);
+    }
+}
+
+// The simulated buzzers cost no interrupts
+void hal_tone_dump_load(void) {
+    printf("[TONE] no tone interrupts on the host\n");
+}
+
+// -----------------------------------------------------------------------------
+// File storage (stdio on rootDir)
+// -----------------------------------------------------------------------------
+bool HalFile::open(const char* path, HalFileMode mode) {
+    char full[512];
+    resolvePath(path, full, sizeof(full));
+    close();
+    switch (mode) {
+        case HAL_FILE_READ:   file = fopen(full, "rb");  break;
+        case HAL_FILE_RDWR:   file = fopen(full, "r+b"); break;
+        case HAL_FILE_CREATE: file = fopen(full, "w+b"); break;
+    }
+    return isOpen();
+}
+
+void HalFile::close(void) {
+    if (file) fclose(file);
+    file = nullptr;
+}
+
+bool HalFile::isOpen(void) const {
+    return file != nullptr;
+}
+
+int HalFile::read(void* buf, uint16_t len) {
+    if (!file) return -1;
+    return (int)fread(buf, 1, len, file);
+}
+
+size_t HalFile::write(const void* buf, size_t len) {
+    if (!file) return 0;
+    return fwrite(buf, 1, len, file);
+}
+
+bool HalFile::seek(uint32_t pos) {
+    return file && fseek(file, (long)pos, SEEK_SET) == 0;
+}
+
+uint32_t HalFile::position(void) {
+    return file ? (uint32_t)ftell(file) : 0;
+}
+
+uint32_t HalFile::size(void) {
+    if (!file) return 0;
+    struct stat st;
+    fflush(file);
+    return fstat(fileno(file), &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+void HalFile::flush(void) {
+    if (file) fflush(file);
+}
+
+bool HalDir::open(const char* path) {
+    char full[512];
+    resolvePath(path, full, sizeof(full));
+    close();
+    dir = opendir(full);
+    return dir != nullptr;
+}
+
+bool HalDir::next(char* name, size_t len) {
+    if (!dir) return false;
+    struct dirent* de;
+    while ((de = readdir((DIR*)dir)) != nullptr) {
+        if (de->d_type == DT_REG) {
+            snprintf(name, len, "%s", de->d_name);
+            return true;
+        }
+    }
+    return false;
+}
+
+void HalDir::close(void) {
+    if (dir) closedir((DIR*)dir);
+    dir = nullptr;
+}
+
+bool hal_fs_begin(uint8_t csPin) {
+    (void)csPin;
+    struct stat st;
+    return stat(rootDir, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool hal_fs_exists(const char* path) {
+    char full[512];
+    struct stat st;
+    resolvePath(path, full, sizeof(full));
+    return stat(full, &st) == 0;
+}
+
+bool hal_fs_remove(const char* path) {
+    char full[512];
+    resolvePath(path, full, sizeof(full));
+    return remove(full) == 0;
+}
+
+#endif // !ARDUINO
@@ -0,0 +1,39 @@
+// hal_native.h
+// Host-only extensions of the HAL used by the native entry points.
+
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include "hal.h"
+
+/**
+ * @brief Set the host directory that stands in for the SD card root.
+ *        Defaults to the current working directory.
+ */
+void hal_native_set_root(const char* dir);
+
+/**
+ * @brief Redirect the HAL console (hal_print) to another stream.
+ *        Defaults to stdout.
+ */
+void hal_native_set_console(FILE* out);
+
+/**
+ * @brief Print every tone start/stop on stdout when enabled.
+ */
+void hal_native_set_tone_trace(bool enabled);
+
+/**
+ * @brief Frequency currently sounding on a voice (0 = silent).
+ */
+uint16_t hal_native_tone_frequency(uint8_t voice);
+
+/**
+ * @brief Run the tick callback, then the scheduler timer callback if its
+ *        deadline has passed.
+ *
+ * The host has no timer interrupt; the native main loop polls instead.
+ */
+void hal_native_timer_poll(void);
+
+#endif // HAL_NATIVE_H
@@ -0,0 +1,107 @@
+// main.cpp (native)
+// Headless host entry point: plays a song from a directory standing in for
+// the SD card, in real time, through the simulated tone voices.
+//
+// Usage: buzzer_player [-d sd_dir] [-q] [-o] [-t tempo%] song.csv|song.bzs
+
+#if !defined(ARDUINO) && !defined(BENCHMARK)
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "hal_native.h"
+#include "sd_card.h"
+#include "player.h"
+#include "seek_index.h"
+#include "event_queue.h"
+#include "oled_gui.h"
+#include "logger.h"
+#include "play_clock.h"
+#include "note_scheduler.h"
+#include "onset_trace.h"
+#include "voices.h"
+
+static void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [-d sd_dir] [-q] [-o] [-t tempo] song\n"
+                  "  -d DIR  directory used as the SD card root (default .)\n"
+                  "  -q      do not trace tone on/off events\n"
+                  "  -o      stream binary onset trace frames to stdout\n"
+                  "  -t PCT  playback speed in percent (default 100)\n", prog);
+}
+
+int main(int argc, char** argv) {
+  bool trace = true;
+  bool onsets = false;
+  int  tempo = PLAY_CLOCK_TEMPO_UNITY;
+  int  opt;
+  while ((opt = getopt(argc, argv, "d:qot:h")) != -1) {
+    switch (opt) {
+      case 'd': hal_native_set_root(optarg); break;
+      case 'q': trace = false;               break;
+      case 'o': onsets = true;               break;
+      case 't': tempo = atoi(optarg);        break;
+      default:  usage(argv[0]);              return 1;
+    }
+  }
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+  const char* song = argv[optind];
+
+  oled_init();
+  if (!sd_init(0)) {
+    oled_show_error("SD init error");
+    return 1;
+  }
+  log_init(0);
+  hal_native_set_tone_trace(trace);
+
+  if (!sd_open_file(song)) {
+    oled_show_error("Open failed");
+    return 1;
+  }
+  if (!seek_index_prepare(song)) {
+    log_event("No seek index");
+  }
+  const SongInfo* info = sd_get_song_info();
+  if (info->eventCount) {
+    printf("[SONG] events=%lu duration_ms=%lu polyphony=%u\n",
+           (unsigned long)info->eventCount, (unsigned long)info->duration / 1000,
+           info->maxPolyphony);
+  }
+  if (info->maxPolyphony > NUM_BUZZERS) {
+    log_event("Polyphony exceeds buzzers");
+  }
+  player_init();
+  onset_trace_enable(onsets);
+  onset_trace_song(song);
+  log_event("Playback START");
+
+  // Same split as the board: the scheduler timer plays notes (polled here
+  // in place of the interrupt) and the loop reads ahead
+  play_clock_reset(0);
+  play_clock_set_tempo(tempo);
+  play_clock_resume();
+  note_scheduler_start();
+  while (!(sd_finished() && player_is_idle())) {
+    hal_native_timer_poll();
+    player_refill(EVENT_QUEUE_SLICE);
+    onset_trace_flush(false);
+    log_flush();
+    usleep(200);
+  }
+  note_scheduler_stop();
+  onset_trace_flush(true);
+
+  const SdReadStats* rs = sd_get_read_stats();
+  printf("[STAT] events=%lu avg_us=%lu max_us=%lu underruns=%u preempted=%u\n",
+         (unsigned long)rs->events,
+         (unsigned long)(rs->events ? rs->totalUs / rs->events : 0),
+         (unsigned long)rs->maxUs,
+         event_queue_underruns(), voices_preempted());
+  log_event("End of song");
+  while (log_flush()) {}
+  return 0;
+}
+
+#endif // !ARDUINO && !BENCHMARK
@@ -0,0 +1,47 @@
+// oled_console.cpp
+// Console stand-in for the TFT display on the host (env:native).
+// Implements oled_gui.h by printing each screen as a single status line.
+
+#ifndef ARDUINO
+
+#include "oled_gui.h"
+
+void oled_init() {
+}
+
+void oled_show_file_list(const char* list[], uint8_t count, uint8_t selected) {
+  printf("[oled] PLAYLIST");
+  for (uint8_t i = 0; i < count; i++) {
+    printf(i == selected ? " [%s]" : " %s", list[i]);
+  }
+  printf("\n");
+}
+
+void oled_show_paused() {
+  printf("[oled] PAUSED\n");
+}
+
+void oled_show_loading() {
+  printf("[oled] Loading...\n");
+}
+
+void oled_show_error(const char* msg) {
+  printf("[oled] ERROR: %s\n", msg);
+}
+
+void oled_show_playback_menu(const char* opts[], uint8_t count, uint8_t sel,
+                             const char* filename, unsigned long playertime,
+                             unsigned long status, uint16_t tempo, long transpose) {
+  unsigned long secs = playertime / 1000;
+  printf("[oled] %s %lu:%02lu %s S:%u.%02u T:%+ld [%s]\n",
+         filename, secs / 60, secs % 60, status ? "Paused" : "Playing",
+         tempo / 100, tempo % 100, transpose, sel < count ? opts[sel] : "");
+}
+
+// Nothing is sent over SPI on the host
+const OledStats* oled_get_stats(void) {
+  static OledStats stats;
+  return &stats;
+}
+
+#endif // !ARDUINO
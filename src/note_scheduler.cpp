@@ -0,0 +1,74 @@
+// note_scheduler.cpp
+// Drives player_update() from the HAL scheduler timer.
+
+#include "note_scheduler.h"
+#include "player.h"
+#include "play_clock.h"
+#include "event_queue.h"
+
+// --- Static module state ---
+static bool          attached = false;
+static volatile bool running  = false;
+
+// ----------------------------------------------------------------------------
+// service()
+//   Timer callback (interrupt context): play everything that is due, then
+//   sleep until the next deadline. Waits are shortened while the queue is
+//   empty but the song is not, since a refill may bring an earlier event.
+// ----------------------------------------------------------------------------
+static void service(void) {
+    if (!running) return;
+
+    play_clock_update();
+    player_update(play_clock_us());
+
+    uint32_t      wait = NOTE_SCHED_MAX_US;
+    unsigned long next;
+    if (player_next_deadline(&next)) {
+        wait = play_clock_us_until(next);
+    }
+    if (event_queue_count() == 0 && !sd_finished() && wait > NOTE_SCHED_IDLE_US) {
+        wait = NOTE_SCHED_IDLE_US;
+    }
+    if (wait > NOTE_SCHED_MAX_US) {
+        wait = NOTE_SCHED_MAX_US;
+    }
+    hal_timer_arm(wait);
+}
+
+// ----------------------------------------------------------------------------
+// note_scheduler_start()
+//   Fire immediately to pick up anything already due.
+// ----------------------------------------------------------------------------
+void note_scheduler_start(void) {
+    if (!attached) {
+        hal_timer_begin(service);
+        attached = true;
+    }
+    running = true;
+    hal_timer_arm(0);
+}
+
+// ----------------------------------------------------------------------------
+// note_scheduler_stop()
+// ----------------------------------------------------------------------------
+void note_scheduler_stop(void) {
+    running = false;
+    hal_timer_disarm();
+}
+
+// ----------------------------------------------------------------------------
+// note_scheduler_rearm()
+//   The armed wait was measured at the old tempo; fire now so service()
+//   measures it again.
+// ----------------------------------------------------------------------------
+void note_scheduler_rearm(void) {
+    if (running) hal_timer_arm(0);
+}
+
+// ----------------------------------------------------------------------------
+// note_scheduler_running()
+// ----------------------------------------------------------------------------
+bool note_scheduler_running(void) {
+    return running;
+}
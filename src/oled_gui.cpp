@@ -6,13 +6,57 @@
 // -----------------------------------------------------------------------------
 // Display pin definitions
 // -----------------------------------------------------------------------------
+#ifdef PINS_UNO
+// 11-13 are the Uno's hardware SPI pins
+#define TFT_CS   8   // Chip Select
+#define TFT_DC   9   // Data/Command
+#define TFT_RST  7   // Reset
+#define TFT_BL   A3  // Backlight
+#else
 #define TFT_CS   8   // Chip Select
 #define TFT_DC   12  // Data/Command
 #define TFT_RST  11  // Reset
 #define TFT_BL    7  // Backlight
+#endif
+
+// -----------------------------------------------------------------------------
+// ST7735 driver that counts the SPI bytes it sends while drawing.
+//   Every pixel the Adafruit driver writes is preceded by a setAddrWindow()
+//   covering exactly the pixels that follow, so each window costs 11 bytes
+//   of CASET/RASET/RAMWR plus 2 bytes per pixel.
+// -----------------------------------------------------------------------------
+class CountingST7735 : public Adafruit_ST7735 {
+public:
+  CountingST7735(int8_t cs, int8_t dc, int8_t rst) : Adafruit_ST7735(cs, dc, rst) {}
+
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) override {
+    spiBytes += 11 + 2UL * w * h;
+    Adafruit_ST7735::setAddrWindow(x, y, w, h);
+  }
+
+  uint32_t spiBytes = 0;
+};
 
 // Single instance of the ST7735 display driver
-static Adafruit_ST7735 tft = Adafruit_ST7735(TFT_CS, TFT_DC, TFT_RST);
+static CountingST7735 tft(TFT_CS, TFT_DC, TFT_RST);
+
+// SPI traffic of the oled_show_*() calls
+static OledStats stats;
+
+// Playback screen state (below); cleared whenever another screen is drawn
+static void invalidatePlayback(void);
+
+// -----------------------------------------------------------------------------
+// endFrame(start)
+//   Account one oled_show_*() call, given the byte count when it started.
+// -----------------------------------------------------------------------------
+static void endFrame(uint32_t start) {
+  uint32_t bytes = tft.spiBytes - start;
+  stats.frames++;
+  stats.lastBytes   = bytes;
+  stats.totalBytes += bytes;
+  if (bytes > stats.maxBytes) stats.maxBytes = bytes;
+}
 
 // -----------------------------------------------------------------------------
 // Icon drawing helpers (all in white)
@@ -42,6 +86,18 @@ static void drawArrowRight(int x, int y) {
 // (Optional left arrow not used)
 // static void drawArrowLeft(int x, int y) { … }
 
+// -----------------------------------------------------------------------------
+// Return the length of a song filename without its “.csv” / “.bzs” suffix.
+// -----------------------------------------------------------------------------
+static size_t displayLength(const char* name) {
+  size_t len = strlen(name);
+  if (len > 4 && (strcasecmp(name + len - 4, ".csv") == 0 ||
+                  strcasecmp(name + len - 4, ".bzs") == 0)) {
+    return len - 4;
+  }
+  return len;
+}
+
 // -----------------------------------------------------------------------------
 // oled_init()
 //   - Enable backlight
@@ -55,6 +111,7 @@ void oled_init() {
   tft.initR(INITR_BLACKTAB);       // Initialize ST7735 with black tab
   tft.setRotation(1);              // Landscape mode
   tft.fillScreen(ST77XX_BLACK);    // Clear to black
+  invalidatePlayback();
 }
 
 // -----------------------------------------------------------------------------
@@ -77,6 +134,8 @@ void oled_show_file_list(const char* list[], uint8_t count, uint8_t sel) {
     pageStart = sel - pageSize + 1;
   }
 
+  uint32_t start = tft.spiBytes;
+  invalidatePlayback();
   tft.fillScreen(ST77XX_BLACK);
 
   // Draw header text
@@ -99,10 +158,9 @@ void oled_show_file_list(const char* list[], uint8_t count, uint8_t sel) {
       tft.setTextColor(ST77XX_WHITE);
     }
 
-    // Trim “.csv” suffix if present
+    // Trim “.csv” / “.bzs” suffix if present
     const char* name = list[idx];
-    size_t len = strlen(name);
-    size_t dispLen = (len > 4 && strcasecmp(name + len - 4, ".csv") == 0) ? len - 4 : len;
+    size_t dispLen = displayLength(name);
 
     tft.setCursor(35, y);
     tft.write((const uint8_t*)name, dispLen);
@@ -113,6 +171,7 @@ void oled_show_file_list(const char* list[], uint8_t count, uint8_t sel) {
   drawArrowUp(iconX, iconX + 10);
   drawArrowRight(iconX, tft.height() / 2 - 5);
   drawArrowDown(iconX, tft.height() - 20);
+  endFrame(start);
 }
 
 // -----------------------------------------------------------------------------
@@ -120,11 +179,14 @@ void oled_show_file_list(const char* list[], uint8_t count, uint8_t sel) {
 //   Clear screen and display “PAUSED” centered.
 // -----------------------------------------------------------------------------
 void oled_show_paused() {
+  uint32_t start = tft.spiBytes;
+  invalidatePlayback();
   tft.fillScreen(ST77XX_BLACK);
   tft.setTextSize(2);
   tft.setTextColor(ST77XX_WHITE);
   tft.setCursor(20, tft.height() / 2 - 8);
   tft.print(F("PAUSED"));
+  endFrame(start);
 }
 
 // -----------------------------------------------------------------------------
@@ -132,11 +194,14 @@ void oled_show_paused() {
 //   Clear screen and display “Loading...” centered.
 // -----------------------------------------------------------------------------
 void oled_show_loading() {
+  uint32_t start = tft.spiBytes;
+  invalidatePlayback();
   tft.fillScreen(ST77XX_BLACK);
   tft.setTextSize(2);
   tft.setTextColor(ST77XX_WHITE);
   tft.setCursor(20, tft.height() / 2 - 8);
   tft.print(F("Loading..."));
+  endFrame(start);
 }
 
 // -----------------------------------------------------------------------------
@@ -144,6 +209,8 @@ void oled_show_loading() {
 //   Clear screen and show error message centered.
 // -----------------------------------------------------------------------------
 void oled_show_error(const char* msg) {
+  uint32_t start = tft.spiBytes;
+  invalidatePlayback();
   tft.fillScreen(ST77XX_BLACK);
   tft.setTextSize(1);
   tft.setTextColor(ST77XX_WHITE);
@@ -151,6 +218,86 @@ void oled_show_error(const char* msg) {
   tft.print(F("ERROR:"));
   tft.setCursor(20, tft.height() / 2);
   tft.print(msg);
+  endFrame(start);
+}
+
+// -----------------------------------------------------------------------------
+// Playback screen widgets
+//   The screen is redrawn in full only when it was not the last one shown
+//   or the song changes. Otherwise only the option cells whose highlight
+//   changed and the characters of the text fields that differ from what is
+//   on screen are repainted.
+// -----------------------------------------------------------------------------
+#define CELL_W  12   // Character cell at text size 2
+#define CELL_H  16
+#define FIELD_LEN 8  // Characters per text field
+
+// One line of text, remembered as drawn
+struct TextField {
+  int16_t x, y;
+  char    text[FIELD_LEN];   // Space padded, not terminated
+};
+
+static struct {
+  bool          valid;       // false: next playback frame is a full redraw
+  const char**  opts;
+  uint8_t       count;
+  uint8_t       sel;
+  const char*   filename;
+  unsigned long status;
+  TextField     paused, time, tempo, transpose;
+} shown;
+
+static void invalidatePlayback(void) {
+  shown.valid = false;
+}
+
+// -----------------------------------------------------------------------------
+// drawOption(opts, i, sel, status, clear)
+//   Paint option cell i; `clear` blanks an unselected cell first (a full
+//   redraw starts from a black screen and skips it).
+// -----------------------------------------------------------------------------
+static void drawOption(const char* opts[], uint8_t i, uint8_t sel,
+                       unsigned long status, bool clear) {
+  int16_t y = i * 16;
+  if (i == sel) {
+    // Highlight background for selected item
+    tft.fillRect(0, y, 30, 16, ST77XX_WHITE);
+    tft.setTextColor(ST77XX_BLACK);
+  } else {
+    if (clear) tft.fillRect(0, y, 30, 16, ST77XX_BLACK);
+    tft.setTextColor(ST77XX_WHITE);
+  }
+
+  // If paused, show a “>” on Play icon
+  if (status && i == 0) {
+    tft.setCursor(10, 2);
+    tft.print('>');
+    return;
+  }
+
+  tft.setCursor(4, y + 2);
+  tft.print(opts[i]);
+}
+
+// -----------------------------------------------------------------------------
+// updateField(f, text, full)
+//   Repaint the characters of f that differ from text (all of them on a
+//   full redraw) and remember text as shown.
+// -----------------------------------------------------------------------------
+static void updateField(TextField& f, const char* text, bool full) {
+  tft.setTextColor(ST77XX_WHITE);
+  for (uint8_t i = 0; i < FIELD_LEN; i++) {
+    char c = *text ? *text++ : ' ';
+    if (!full && c == f.text[i]) continue;
+    int16_t x = f.x + i * CELL_W;
+    if (!full) tft.fillRect(x, f.y, CELL_W, CELL_H, ST77XX_BLACK);
+    if (c != ' ') {
+      tft.setCursor(x, f.y);
+      tft.print(c);
+    }
+    f.text[i] = c;
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -162,69 +309,73 @@ void oled_show_error(const char* msg) {
 //   - filename:  current file name (trimmed by caller)
 //   - playertime: elapsed playback time in ms
 //   - status:    0 = playing, 1 = paused
-//   - tempo:     current speed multiplier
+//   - tempo:     current speed in percent, shown as a multiplier
 //   - transpose: semitone offset (signed)
 // -----------------------------------------------------------------------------
 void oled_show_playback_menu(const char* opts[], uint8_t count,
                              uint8_t sel, const char* filename,
                              unsigned long playertime, unsigned long status,
-                             double tempo, long transpose) {
-  tft.fillScreen(ST77XX_BLACK);
+                             uint16_t tempo, long transpose) {
+  uint32_t start = tft.spiBytes;
+  bool full = !shown.valid || opts != shown.opts || count != shown.count
+              || strcmp(filename, shown.filename) != 0;
+
   tft.setTextSize(2);
+  if (full) {
+    tft.fillScreen(ST77XX_BLACK);
 
-  // Draw vertical list of control icons
-  for (uint8_t i = 0; i < count; i++) {
-    int16_t y = i * 16;
-    if (i == sel) {
-      // Highlight background for selected item
-      tft.fillRect(0, y, 30, 16, ST77XX_WHITE);
-      tft.setTextColor(ST77XX_BLACK);
-    } else {
-      tft.setTextColor(ST77XX_WHITE);
+    // Draw vertical list of control icons
+    for (uint8_t i = 0; i < count; i++) {
+      drawOption(opts, i, sel, status, false);
     }
 
-    // If paused, show a “>” on Play icon
-    if (status && i == 0) {
-      tft.setCursor(10, 2);
-      tft.print('>');
-      continue;
-    }
+    // Display filename (trim “.csv” / “.bzs” if present)
+    tft.setTextColor(ST77XX_WHITE);
+    size_t dispLen = displayLength(filename);
+    tft.setCursor(tft.width() - (dispLen * 6), 10);
+    tft.write((const uint8_t*)filename, dispLen);
 
-    tft.setCursor(4, y + 2);
-    tft.print(opts[i]);
+    int16_t x = tft.width() - 100;
+    shown.paused.x    = x;  shown.paused.y    = 30;
+    shown.time.x      = x;  shown.time.y      = 65;
+    shown.tempo.x     = x;  shown.tempo.y     = 90;
+    shown.transpose.x = x;  shown.transpose.y = 105;
+  } else {
+    // Only the cells whose look changed
+    for (uint8_t i = 0; i < count; i++) {
+      bool wasSel = (i == shown.sel), isSel = (i == sel);
+      if (wasSel != isSel || (i == 0 && status != shown.status)) {
+        drawOption(opts, i, sel, status, true);
+      }
+    }
   }
 
-  // Display filename (trim “.csv” if present)
-  tft.setTextColor(ST77XX_WHITE);
-  size_t len     = strlen(filename);
-  size_t dispLen = (len > 4 && strcasecmp(filename + len - 4, ".csv") == 0) ? len - 4 : len;
-  tft.setCursor(tft.width() - (dispLen * 6), 10);
-  tft.write((const uint8_t*)filename, dispLen);
-
-  // Show paused status text
-  tft.setCursor(tft.width() - 100, 30);
-  if (status) {
-    tft.print("Paused");
-  }
+  // Paused status, minutes:seconds, tempo and transpose values
+  char buf[FIELD_LEN + 1];
+  updateField(shown.paused, status ? "Paused" : "", full);
 
-  // Compute minutes:seconds from milliseconds
   unsigned long secs = playertime / 1000;
-  unsigned long mins = secs / 60;
-  secs = secs % 60;
-
-  // Draw time
-  tft.setCursor(tft.width() - 100, 65);
-  tft.print(mins);
-  tft.print(':');
-  if (secs < 10) tft.print('0');
-  tft.print(secs);
-
-  // Draw tempo and transpose values
-  tft.setCursor(tft.width() - 100, 90);
-  tft.print("S: ");
-  tft.print(tempo);
-  tft.setCursor(tft.width() - 100, 105);
-  tft.print("T: ");
-  if (transpose >= 0) tft.print('+');
-  tft.print(transpose);
+  snprintf(buf, sizeof(buf), "%lu:%02lu", secs / 60, secs % 60);
+  updateField(shown.time, buf, full);
+
+  snprintf(buf, sizeof(buf), "S: %u.%02u", tempo / 100, tempo % 100);
+  updateField(shown.tempo, buf, full);
+
+  snprintf(buf, sizeof(buf), "T: %+ld", transpose);
+  updateField(shown.transpose, buf, full);
+
+  shown.valid    = true;
+  shown.opts     = opts;
+  shown.count    = count;
+  shown.sel      = sel;
+  shown.filename = filename;
+  shown.status   = status;
+  endFrame(start);
+}
+
+// -----------------------------------------------------------------------------
+// oled_get_stats()
+// -----------------------------------------------------------------------------
+const OledStats* oled_get_stats(void) {
+  return &stats;
 }
@@ -0,0 +1,128 @@
+// onset_trace.cpp
+// Single-producer (scheduler) / single-consumer (loop) ring of note timing
+// records, streamed as binary frames. Same lock-free scheme as
+// event_queue.cpp: a slot is filled before tail moves past it and read
+// before head releases it.
+
+#include "onset_trace.h"
+#include "play_clock.h"
+
+#if (ONSET_TRACE_SIZE & (ONSET_TRACE_SIZE - 1)) != 0 || ONSET_TRACE_SIZE > 128
+#error "ONSET_TRACE_SIZE must be a power of two no larger than 128"
+#endif
+
+#define ONSET_TRACE_MASK (ONSET_TRACE_SIZE - 1)
+
+struct OnsetRecord {
+    uint16_t seq;
+    uint8_t  flags;
+    uint32_t due;
+    uint32_t actual;
+};
+
+// --- Static module state ---
+static OnsetRecord      ring[ONSET_TRACE_SIZE];
+static volatile uint8_t head;
+static volatile uint8_t tail;
+static volatile bool    enabled = false;
+static uint16_t         seq;        // Scheduler side only
+static uint16_t         dropped;
+
+// ----------------------------------------------------------------------------
+// onset_trace_enable(on) / onset_trace_enabled()
+// ----------------------------------------------------------------------------
+void onset_trace_enable(bool on) {
+    uint8_t irq = hal_irq_save();
+    enabled = on;
+    head    = 0;
+    tail    = 0;
+    seq     = 0;
+    dropped = 0;
+    hal_irq_restore(irq);
+}
+
+bool onset_trace_enabled(void) {
+    return enabled;
+}
+
+// ----------------------------------------------------------------------------
+// onset_trace_note(voice, off, due)
+//   The sequence number advances even when the record is dropped, so the
+//   host sees the gap.
+// ----------------------------------------------------------------------------
+void onset_trace_note(uint8_t voice, bool off, uint32_t due) {
+    if (!enabled) return;
+
+    play_clock_update();
+    uint32_t actual = play_clock_us();
+
+    uint8_t t = tail;
+    if ((uint8_t)(t - head) >= ONSET_TRACE_SIZE) {
+        dropped++;
+        seq++;
+        return;
+    }
+    OnsetRecord& r = ring[t & ONSET_TRACE_MASK];
+    r.seq    = seq++;
+    r.flags  = (voice & 0x7F) | (off ? ONSET_FLAG_OFF : 0);
+    r.due    = due;
+    r.actual = actual;
+    HAL_BARRIER();
+    tail = t + 1;
+}
+
+// ----------------------------------------------------------------------------
+// putLE(p, v, n)
+//   Store the low n bytes of v, least significant first.
+// ----------------------------------------------------------------------------
+static uint8_t* putLE(uint8_t* p, uint32_t v, uint8_t n) {
+    while (n--) {
+        *p++ = (uint8_t)v;
+        v >>= 8;
+    }
+    return p;
+}
+
+// ----------------------------------------------------------------------------
+// onset_trace_flush(all)
+// ----------------------------------------------------------------------------
+void onset_trace_flush(bool all) {
+    uint8_t h = head;
+    while (h != tail) {
+        if (!all && hal_write_room() < ONSET_FRAME_SIZE) break;
+
+        const OnsetRecord& r = ring[h & ONSET_TRACE_MASK];
+        uint8_t  frame[ONSET_FRAME_SIZE];
+        uint8_t* p = frame;
+        *p++ = ONSET_SYNC0;
+        *p++ = ONSET_SYNC1;
+        p = putLE(p, r.seq, 2);
+        *p++ = r.flags;
+        p = putLE(p, r.due, 4);
+        p = putLE(p, r.actual, 4);
+        uint8_t check = 0;
+        for (uint8_t* q = frame + 2; q < p; q++) check += *q;
+        *p = check;
+        HAL_BARRIER();
+        head = ++h;
+
+        hal_write(frame, sizeof(frame));
+    }
+}
+
+// ----------------------------------------------------------------------------
+// onset_trace_song(name)
+// ----------------------------------------------------------------------------
+void onset_trace_song(const char* name) {
+    if (!enabled) return;
+    onset_trace_flush(true);
+    hal_print(F("[TRACE] song "));
+    hal_println(name);
+}
+
+// ----------------------------------------------------------------------------
+// onset_trace_dropped()
+// ----------------------------------------------------------------------------
+uint16_t onset_trace_dropped(void) {
+    return dropped;
+}
@@ -0,0 +1,52 @@
+// pitch.cpp
+// MIDI note number → frequency lookup table.
+
+#include "pitch.h"
+
+// Equal-tempered frequency (Hz, rounded) of every MIDI note, A4 (69) = 440 Hz.
+// Same rounding as midi_csv_generator, so CSV and binary songs agree.
+static const uint16_t noteHz[PITCH_NOTE_COUNT] PROGMEM = {
+        8,     9,     9,    10,    10,    11,    12,    12,  // 0..7
+       13,    14,    15,    15,    16,    17,    18,    19,  // 8..15
+       21,    22,    23,    24,    26,    28,    29,    31,  // 16..23
+       33,    35,    37,    39,    41,    44,    46,    49,  // 24..31
+       52,    55,    58,    62,    65,    69,    73,    78,  // 32..39
+       82,    87,    92,    98,   104,   110,   117,   123,  // 40..47
+      131,   139,   147,   156,   165,   175,   185,   196,  // 48..55
+      208,   220,   233,   247,   262,   277,   294,   311,  // 56..63
+      330,   349,   370,   392,   415,   440,   466,   494,  // 64..71
+      523,   554,   587,   622,   659,   698,   740,   784,  // 72..79
+      831,   880,   932,   988,  1047,  1109,  1175,  1245,  // 80..87
+     1319,  1397,  1480,  1568,  1661,  1760,  1865,  1976,  // 88..95
+     2093,  2217,  2349,  2489,  2637,  2794,  2960,  3136,  // 96..103
+     3322,  3520,  3729,  3951,  4186,  4435,  4699,  4978,  // 104..111
+     5274,  5588,  5920,  6272,  6645,  7040,  7459,  7902,  // 112..119
+     8372,  8870,  9397,  9956, 10548, 11175, 11840, 12544,  // 120..127
+};
+
+// ----------------------------------------------------------------------------
+// pitch_note_to_hz(note)
+//   Table lookup; notes above 127 are clamped to the top of the table.
+// ----------------------------------------------------------------------------
+uint16_t pitch_note_to_hz(uint8_t note) {
+    if (note >= PITCH_NOTE_COUNT) note = PITCH_NOTE_COUNT - 1;
+    return pgm_read_word(&noteHz[note]);
+}
+
+// ----------------------------------------------------------------------------
+// pitch_hz_to_note(hz)
+//   Binary search for the first note at or above hz, then take whichever
+//   neighbour is closer. Runs when songs are parsed, not at note-on.
+// ----------------------------------------------------------------------------
+uint8_t pitch_hz_to_note(uint16_t hz) {
+    uint8_t lo = 0, hi = PITCH_NOTE_COUNT - 1;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if (pgm_read_word(&noteHz[mid]) < hz) lo = mid + 1;
+        else                                  hi = mid;
+    }
+    if (lo > 0 && hz - pgm_read_word(&noteHz[lo - 1]) < pgm_read_word(&noteHz[lo]) - hz) {
+        lo--;
+    }
+    return lo;
+}
@@ -0,0 +1,154 @@
+// play_clock.cpp
+// Fixed-point song clock: real µs × tempo% accumulated without rounding.
+
+#include "play_clock.h"
+
+// One song microsecond expressed in the accumulator's unit (µs × percent)
+#define UNITS_PER_US  PLAY_CLOCK_TEMPO_UNITY
+
+// Largest real-time step folded in at once: keeps step × tempo + remainder
+// within 32 bits (1e6 × 400 + 100 < 2^32)
+#define MAX_STEP_US   1000000UL
+
+// --- Static module state ---
+static uint32_t songUs;      // Whole song microseconds
+static uint32_t fracUnits;   // Sub-microsecond remainder, < UNITS_PER_US
+static uint32_t lastUs;      // hal_micros() at the last update
+static uint16_t tempo;       // Percent of normal speed
+static bool     running;
+
+// ----------------------------------------------------------------------------
+// play_clock_reset(us)
+//   Stopped at us, normal speed.
+// ----------------------------------------------------------------------------
+void play_clock_reset(uint32_t us) {
+    uint8_t irq = hal_irq_save();
+    songUs    = us;
+    fracUnits = 0;
+    tempo     = PLAY_CLOCK_TEMPO_UNITY;
+    running   = false;
+    hal_irq_restore(irq);
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_resume() / play_clock_pause()
+//   Pausing folds in the time played so far; resuming restarts the
+//   real-time reference so the paused interval is not counted.
+// ----------------------------------------------------------------------------
+void play_clock_resume(void) {
+    uint8_t irq = hal_irq_save();
+    lastUs  = hal_micros();
+    running = true;
+    hal_irq_restore(irq);
+}
+
+void play_clock_pause(void) {
+    uint8_t irq = hal_irq_save();
+    play_clock_update();
+    running = false;
+    hal_irq_restore(irq);
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_set(us)
+//   Jump to a new position, dropping the sub-microsecond remainder.
+// ----------------------------------------------------------------------------
+void play_clock_set(uint32_t us) {
+    uint8_t irq = hal_irq_save();
+    songUs    = us;
+    fracUnits = 0;
+    lastUs    = hal_micros();
+    hal_irq_restore(irq);
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_update()
+//   fracUnits collects elapsed µs × tempo; whole song microseconds move
+//   into songUs and the exact remainder stays behind. At normal speed the
+//   division is skipped entirely.
+// ----------------------------------------------------------------------------
+void play_clock_update(void) {
+    uint8_t irq = hal_irq_save();
+    if (!running) {
+        hal_irq_restore(irq);
+        return;
+    }
+
+    uint32_t now     = hal_micros();
+    uint32_t elapsed = now - lastUs;    // Wrap-safe
+    lastUs = now;
+
+    if (tempo == PLAY_CLOCK_TEMPO_UNITY) {
+        songUs += elapsed;
+    } else {
+        while (elapsed > 0) {
+            uint32_t step = elapsed > MAX_STEP_US ? MAX_STEP_US : elapsed;
+            elapsed   -= step;
+            fracUnits += step * tempo;
+            uint32_t whole = fracUnits / UNITS_PER_US;
+            songUs    += whole;
+            fracUnits -= whole * UNITS_PER_US;
+        }
+    }
+    hal_irq_restore(irq);
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_us() / play_clock_ms()
+// ----------------------------------------------------------------------------
+uint32_t play_clock_us(void) {
+    uint8_t  irq = hal_irq_save();
+    uint32_t us  = songUs;
+    hal_irq_restore(irq);
+    return us;
+}
+
+uint32_t play_clock_ms(void) {
+    return play_clock_us() / 1000;
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_us_until(us)
+//   Song units still to go, divided by the tempo. Distances beyond the
+//   saturation point are cut off before they can overflow the multiply.
+// ----------------------------------------------------------------------------
+uint32_t play_clock_us_until(uint32_t us) {
+    uint8_t  irq  = hal_irq_save();
+    int32_t  diff = (int32_t)(us - songUs);
+    uint32_t wait;
+    if (diff <= 0) {
+        wait = 0;
+    } else if ((uint32_t)diff > PLAY_CLOCK_MAX_WAIT_US / PLAY_CLOCK_TEMPO_UNITY
+                                * PLAY_CLOCK_TEMPO_MAX) {
+        wait = PLAY_CLOCK_MAX_WAIT_US;
+    } else if (tempo == PLAY_CLOCK_TEMPO_UNITY) {
+        wait = (uint32_t)diff;
+    } else {
+        uint32_t units = (uint32_t)diff * UNITS_PER_US - fracUnits;
+        wait = (units + tempo - 1) / tempo;
+        if (wait > PLAY_CLOCK_MAX_WAIT_US) wait = PLAY_CLOCK_MAX_WAIT_US;
+    }
+    hal_irq_restore(irq);
+    return wait;
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_set_tempo(percent)
+//   Settle the time elapsed at the old tempo before switching.
+// ----------------------------------------------------------------------------
+void play_clock_set_tempo(int16_t percent) {
+    if (percent < PLAY_CLOCK_TEMPO_MIN) percent = PLAY_CLOCK_TEMPO_MIN;
+    if (percent > PLAY_CLOCK_TEMPO_MAX) percent = PLAY_CLOCK_TEMPO_MAX;
+
+    uint8_t irq = hal_irq_save();
+    play_clock_update();
+    tempo = (uint16_t)percent;
+    hal_irq_restore(irq);
+}
+
+// ----------------------------------------------------------------------------
+// play_clock_tempo()
+// ----------------------------------------------------------------------------
+uint16_t play_clock_tempo(void) {
+    return tempo;
+}
@@ -1,153 +1,268 @@
 #include "player.h"
-#include "logger.h"  
+#include "logger.h"
+#include "seek_index.h"
+#include "event_queue.h"
+#include "voices.h"
+#include "pitch.h"
+#include "onset_trace.h"
 
 // --- Static state for note scheduling ---
-// Next upcoming note event from CSV, and flag indicating if it's loaded
-static NoteEvent nextEvent;
-static bool      nextLoaded;
+// Upcoming note events are pre-parsed into the event queue (event_queue.h);
+// player_update() only ever pops from RAM.
 
-// Array of currently active (playing) note events and its count
-static NoteEvent activeEvents[MAX_ACTIVE_EVENTS];
-static uint8_t   activeCount;
+// Sounding notes are tracked per buzzer in the voice table (voices.h).
+// Notes with buzzer 0 are unassigned: the voice table picks their buzzer
+// when they start, so one song plays on any NUM_BUZZERS.
 
-// Buzzer hardware: pin assignments and Tone objects
-static const int buzzerPins[NUM_BUZZERS] = {28, 29, 30, 31, 32};
-static Tone      buzzers[NUM_BUZZERS];
+#if NUM_BUZZERS < 1 || NUM_BUZZERS > VOICE_COUNT
+#error "NUM_BUZZERS must be between 1 and VOICE_COUNT"
+#endif
+#if defined(ARDUINO) && !defined(HAL_TONE_DDS) && NUM_BUZZERS > 5
+#error "Tone has timers for 5 buzzers next to millis(); build with HAL_TONE_DDS for more"
+#endif
+
+// Buzzer hardware: pin assignments (voice i of the HAL drives buzzerPins[i])
+#ifdef BUZZER_OC_PINS
+// Each buzzer on the OCnA pin of the timer Tone gives it (timers 2, 3, 4, 5),
+// so sustained notes toggle in hardware with no interrupts. Timer1's OC1A
+// (pin 11) is the display reset, so the last buzzer stays on the ISR path.
+static const uint8_t buzzerPins[] = {10, 5, 6, 46, 32};
+#elif defined(PINS_UNO)
+// Uno (HAL_TONE_DDS): 2-6 share port D, then A4 and A5
+static const uint8_t buzzerPins[] = {2, 3, 4, 5, 6, 18, 19};
+#else
+static const uint8_t buzzerPins[] = {28, 29, 30, 31, 32, 33, 34, 35};
+#endif
+static_assert(sizeof(buzzerPins) >= NUM_BUZZERS, "more buzzers than pins");
 
 // Initialization flag: configure buzzers only once
 static bool initiated = false;
 
-// Playback control factors
-static double tempoFactor        = 1.0;  // Speed multiplier (1.0 = normal speed)
-static double transposeFactor    = 1.0;  // Frequency multiplier for transpose
-static int    transposeSemitones = 0;    // Total semitone offset applied
+// Transpose, added to each note number before the pitch lookup
+// (tempo is applied by the song clock, play_clock.h)
+static int transposeSemitones = 0;
 
 // Name of the currently open CSV file (used for seeking)
 static const char* currentFile = nullptr;
 
 // -----------------------------------------------------------------------------
 // player_init()
-//   - Set up each buzzer pin via Tone.begin() (only once).
-//   - Reset tempo, transpose, and active event list.
-//   - Preload the first NoteEvent from the open CSV.
+//   - Attach a HAL tone voice to each buzzer pin (only once).
+//   - Reset transpose and the voice table.
+//   - Fill the event queue from the open song.
 // -----------------------------------------------------------------------------
 void player_init(void) {
     if (!initiated) {
         for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
-            buzzers[i].begin(buzzerPins[i]);
+            hal_tone_begin(i, buzzerPins[i]);
         }
         initiated = true;
     }
-    tempoFactor     = 1.0;
-    transposeFactor = 1.0;
-    activeCount     = 0;
-    nextLoaded      = sd_read_next_event(&nextEvent);
-    currentFile     = nullptr;
+    transposeSemitones = 0;
+    currentFile        = nullptr;
+    voices_reset();
+    event_queue_reset();
+    event_queue_refill(EVENT_QUEUE_SIZE);
 }
 
 // -----------------------------------------------------------------------------
 // player_stop_all()
 //   - Immediately stop all currently playing notes.
-//   - Clear the activeEvents queue.
+//   - Clear the voice table.
 // -----------------------------------------------------------------------------
 void player_stop_all(void) {
-    for (uint8_t i = 0; i < activeCount; i++) {
-        int idx = activeEvents[i].buzzer - 1;
-        if (idx >= 0 && idx < NUM_BUZZERS) {
-            buzzers[idx].stop();
+    for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+        if (voices_busy(i)) {
+            hal_tone_stop(i);
         }
     }
-    activeCount = 0;
-    interrupts(); // Ensure interrupts are enabled for Tone timing
+    voices_reset();
+    hal_enable_interrupts(); // Ensure interrupts are enabled for Tone timing
+}
+
+// -----------------------------------------------------------------------------
+// transposedNote(note)
+//   - Song note shifted by the transpose, clamped to the MIDI range.
+// -----------------------------------------------------------------------------
+static uint8_t transposedNote(uint8_t note) {
+    int shifted = note + transposeSemitones;
+    if (shifted < 0) shifted = 0;
+    if (shifted >= PITCH_NOTE_COUNT) shifted = PITCH_NOTE_COUNT - 1;
+    return (uint8_t)shifted;
+}
+
+// -----------------------------------------------------------------------------
+// playNote(idx, ev)
+//   - Start ev on buzzer idx and track it in the voice table.
+// -----------------------------------------------------------------------------
+static void playNote(uint8_t idx, const NoteEvent& ev) {
+    hal_tone_play_note(idx, transposedNote(ev.note));
+    voices_start(idx, ev.startTime, ev.endTime, ev.note);
+}
+
+// -----------------------------------------------------------------------------
+// voiceFor(ev)
+//   - Buzzer index for ev: its own buzzer, or one allocated from the voice
+//     table if it is unassigned (buzzer 0).
+//   - Returns -1 if ev names a buzzer this build does not have.
+// -----------------------------------------------------------------------------
+static int voiceFor(const NoteEvent& ev) {
+    if (ev.buzzer == 0) {
+        return voices_allocate(NUM_BUZZERS, ev.startTime);
+    }
+    return ev.buzzer <= NUM_BUZZERS ? ev.buzzer - 1 : -1;
 }
 
 // -----------------------------------------------------------------------------
 // player_modify_transpose(semitones)
 //   - Adjust global semitone offset.
-//   - Recompute transposeFactor = 2^(semitones/12).
+//   - Re-pitch the notes already sounding.
+//   Interrupts stay off throughout, since player_update() reads both the
+//   offset and the voice table from the note scheduler interrupt.
 // -----------------------------------------------------------------------------
 void player_modify_transpose(int semitones) {
+    uint8_t irq = hal_irq_save();
     transposeSemitones += semitones;
-    transposeFactor = pow(2.0, transposeSemitones / 12.0);
+    for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+        if (voices_busy(i)) {
+            hal_tone_play_note(i, transposedNote(voices_note(i)));
+        }
+    }
+    hal_irq_restore(irq);
 }
 
 // -----------------------------------------------------------------------------
 // player_update(currentTime)
-//   - Called in loop() when playing.
-//   - Starts any notes whose startTime ≤ currentTime*tempoFactor.
-//   - Stops notes whose endTime ≤ currentTime*tempoFactor.
+//   - Called in loop() when playing, with the song position from play_clock.
+//   - Starts any queued notes whose startTime ≤ currentTime; unassigned
+//     notes take a free buzzer or preempt one (voices_allocate()).
+//   - Stops notes whose endTime ≤ currentTime, earliest first.
+//     A note started on a busy buzzer replaces the old one in the voice
+//     table, so only the newest note on a buzzer can stop it.
+//   - Reports each note on/off to the onset trace (onset_trace.h).
 // -----------------------------------------------------------------------------
 void player_update(unsigned long currentTime) {
-    interrupts(); // Allow Tone library interrupts for accurate timing
+    hal_enable_interrupts(); // Allow Tone library interrupts for accurate timing
 
     // Start new notes as long as their scheduled time has arrived
-    while (nextLoaded && nextEvent.startTime <= currentTime * tempoFactor) {
-        int idx = nextEvent.buzzer - 1;
-        if (idx >= 0 && idx < NUM_BUZZERS) {
-            uint16_t freq = (uint16_t)(nextEvent.frequency * transposeFactor);
-            buzzers[idx].play(freq);
-            if (activeCount < MAX_ACTIVE_EVENTS) {
-                activeEvents[activeCount++] = nextEvent;
-            }
+    const NoteEvent* next;
+    while ((next = event_queue_peek_due(currentTime))) {
+        int idx = voiceFor(*next);
+        if (idx >= 0) {
+            playNote(idx, *next);
+            onset_trace_note(idx, false, next->startTime);
         }
-        nextLoaded = sd_read_next_event(&nextEvent);
+        event_queue_pop();
     }
 
     // Stop any notes whose end time has passed
-    for (uint8_t i = 0; i < activeCount; ) {
-        if (activeEvents[i].endTime <= currentTime * tempoFactor) {
-            int idx = activeEvents[i].buzzer - 1;
-            if (idx >= 0 && idx < NUM_BUZZERS) {
-                buzzers[idx].stop();
-            }
-            // Remove this event by shifting the array down
-            for (uint8_t j = i; j + 1 < activeCount; j++) {
-                activeEvents[j] = activeEvents[j + 1];
-            }
-            activeCount--;
-        } else {
-            i++;
-        }
+    uint8_t       idx;
+    unsigned long due;
+    while (voices_next_end(&due) && (idx = voices_pop_expired(currentTime)) != VOICE_NONE) {
+        hal_tone_stop(idx);
+        onset_trace_note(idx, true, due);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// player_next_deadline(time)
+//   - Earlier of the next queued start and the earliest voice end.
+// -----------------------------------------------------------------------------
+bool player_next_deadline(unsigned long* time) {
+    bool          found = false;
+    unsigned long end;
+    if (event_queue_count() > 0) {
+        *time = event_queue_peek()->startTime;
+        found = true;
     }
+    if (voices_next_end(&end) && (!found || end < *time)) {
+        *time = end;
+        found = true;
+    }
+    return found;
+}
+
+// -----------------------------------------------------------------------------
+// player_refill(maxEvents)
+//   - Top up the event queue from SD; called from loop() when it has slack.
+// -----------------------------------------------------------------------------
+uint8_t player_refill(uint8_t maxEvents) {
+    return event_queue_refill(maxEvents);
 }
 
 // -----------------------------------------------------------------------------
 // player_is_idle()
-//   - Returns true if no more events are loaded and no notes are sounding.
+//   - Returns true if no more events are queued or unread and no notes are
+//     sounding.
 // -----------------------------------------------------------------------------
 bool player_is_idle(void) {
-    return (!nextLoaded && activeCount == 0);
+    return (event_queue_drained() && voices_active() == 0);
+}
+
+// -----------------------------------------------------------------------------
+// replaySeekNote(ev)
+//   - Enter a note that started before the seek target in the voice table,
+//     replacing whatever its buzzer held, as player_update() would have.
+//     Nothing is sounded yet.
+// -----------------------------------------------------------------------------
+static void replaySeekNote(const NoteEvent& ev) {
+    int idx = voiceFor(ev);
+    if (idx >= 0) {
+        voices_start(idx, ev.startTime, ev.endTime, ev.note);
+    }
 }
 
 // -----------------------------------------------------------------------------
 // player_seek(newTime, filename)
 //   - Perform a “seek” to newTime within the current file.
-//   - Stops all notes, reopens the file, and parses events up to newTime.
-//   - Any notes still sounding at newTime are started immediately.
+//   - Stops all notes and reopens the file.
+//   - If the song has a seek index, jumps to the last checkpoint before
+//     newTime and restores the voice table saved there; otherwise starts
+//     from the first event.
+//   - Replays the voice table through every event up to newTime, so a note
+//     that was replaced or preempted before newTime stays silent, then
+//     sounds the notes still playing at newTime.
 // -----------------------------------------------------------------------------
 void player_seek(unsigned long newTime, const char* filename) {
     // 1) Stop all currently playing notes
     player_stop_all();
 
-    // 2) Reopen the CSV file and reset state
+    // 2) Reopen the song file and reset state
     currentFile = filename;
     sd_open_file(currentFile);
-    activeCount = 0;
-    nextLoaded  = sd_read_next_event(&nextEvent);
-
-    // 3) Parse events until newTime
-    while (nextLoaded && nextEvent.startTime <= newTime) {
-        // If a note overlaps newTime, start it now
-        if (nextEvent.endTime > newTime) {
-            int idx = nextEvent.buzzer - 1;
-            if (idx >= 0 && idx < NUM_BUZZERS) {
-                uint16_t freq = (uint16_t)(nextEvent.frequency * transposeFactor);
-                buzzers[idx].play(freq);
-                if (activeCount < MAX_ACTIVE_EVENTS) {
-                    activeEvents[activeCount++] = nextEvent;
-                }
+    event_queue_reset();
+
+    // 3) Jump to the nearest checkpoint, if indexed
+    IndexEntry cp;
+    if (seek_index_lookup(newTime, &cp) && sd_seek(cp.offset, cp.baseTime)) {
+        for (uint8_t v = 0; v < NUM_BUZZERS; v++) {
+            const IndexVoice& iv = cp.voices[v];
+            if (iv.endTime) {
+                voices_start(v, iv.startTime, iv.endTime, iv.note);
             }
         }
-        nextLoaded = sd_read_next_event(&nextEvent);
     }
+
+    // 4) Replay events until newTime, including those that end before it:
+    //    they still replace the note on their buzzer
+    NoteEvent ev;
+    bool      loaded;
+    while ((loaded = sd_read_next_event(&ev)) && ev.startTime <= newTime) {
+        replaySeekNote(ev);
+    }
+
+    // 5) Drop the notes that ended by newTime and sound the rest
+    while (voices_pop_expired(newTime) != VOICE_NONE) {
+    }
+    for (uint8_t i = 0; i < NUM_BUZZERS; i++) {
+        if (voices_busy(i)) {
+            hal_tone_play_note(i, transposedNote(voices_note(i)));
+        }
+    }
+
+    // 6) The first future event heads the queue; read ahead behind it
+    if (loaded) {
+        event_queue_push(&ev);
+    }
+    event_queue_refill(EVENT_QUEUE_SIZE);
 }
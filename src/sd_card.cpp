@@ -1,59 +1,163 @@
 // sd_card.cpp
-// Implements SD card operations for listing CSV files and reading NoteEvent records.
+// Implements SD card operations for listing song files and reading NoteEvent records.
+// Events are tokenized (CSV), copied (fixed binary) or incrementally decoded
+// (delta binary) from a fixed read-ahead buffer without heap allocation.
 
 #include "sd_card.h"
+#include "song_format.h"
+#include "pitch.h"
+
+// Encoding of the open file: a SONG_FMT_* value, or SD_FMT_CSV for text
+#define SD_FMT_CSV  0xFF
 
 // --- Static module state ---
-// File handle for the currently opened CSV file
-static File   noteFile;
+// File handle for the currently opened song file
+static HalFile noteFile;
 // Flag indicating whether we've reached end of file or encountered an error
 static bool   finished;
+// Encoding of the open file (SONG_FMT_* or SD_FMT_CSV)
+static uint8_t songFormat;
+// Delta format: start time of the previously decoded event (file ticks)
+static uint32_t deltaBase;
+// Factor from file ticks to NoteEvent µs (SongInfo::tickUs)
+static uint32_t timeScale;
+// Records still to be read from a binary song, and where the records begin
+static uint32_t eventsLeft;
+static uint32_t eventCount;
+static uint16_t recordsStart;
+
+// Read-ahead buffer for the note file, refilled with bulk File::read() calls.
+// The CSV tokenizer parses digits straight out of it, so no String or other
+// heap object is ever created on the event path.
+static uint8_t readBuf[SD_READ_BUF_SIZE];
+static uint8_t readPos;     // index of the next unread byte in readBuf
+static uint8_t readLen;     // number of valid bytes in readBuf
+static uint16_t lineNo;     // current CSV line (for parse error reports)
+
+// Per-file parse cost statistics
+static SdReadStats readStats;
+
+// Metadata of the open song (header fields all 0 for CSV)
+static SongInfo songInfo;
 
 // Storage for directory listing of CSV filenames
 static char   fileNames[MAX_FILES][MAX_FN_LEN];
 static uint8_t fileCount;
 
+// ----------------------------------------------------------------------------
+// fillBuffer() / nextByte()
+//   Return the next byte of the note file, refilling readBuf in one bulk
+//   read when it runs dry. Returns -1 at end of file.
+// ----------------------------------------------------------------------------
+static bool fillBuffer(void) {
+    int n = noteFile.read(readBuf, SD_READ_BUF_SIZE);
+    readPos = 0;
+    readLen = (n > 0) ? (uint8_t)n : 0;
+    return readLen > 0;
+}
+
+static int nextByte(void) {
+    if (readPos >= readLen && !fillBuffer()) {
+        return -1;
+    }
+    return readBuf[readPos++];
+}
+
+// ----------------------------------------------------------------------------
+// readBytes(dst, len)
+//   Copy len bytes of the note file into dst through readBuf.
+//   Returns the number of bytes copied (less than len only at end of file).
+// ----------------------------------------------------------------------------
+static uint8_t readBytes(void* dst, uint8_t len) {
+    uint8_t* out  = (uint8_t*)dst;
+    uint8_t  done = 0;
+    while (done < len) {
+        if (readPos >= readLen && !fillBuffer()) break;
+        uint8_t chunk = readLen - readPos;
+        if (chunk > len - done) chunk = len - done;
+        memcpy(out + done, readBuf + readPos, chunk);
+        readPos += chunk;
+        done    += chunk;
+    }
+    return done;
+}
+
+// ----------------------------------------------------------------------------
+// skipField(nonBlank)
+//   Consume bytes up to and including the next ',' or '\n'.
+//   Sets *nonBlank if anything other than whitespace was seen.
+//   Returns the delimiter, or -1 at end of file.
+// ----------------------------------------------------------------------------
+static int skipField(bool* nonBlank) {
+    int c;
+    while ((c = nextByte()) >= 0 && c != ',' && c != '\n') {
+        if (c != ' ' && c != '\t' && c != '\r') *nonBlank = true;
+    }
+    return c;
+}
+
+// ----------------------------------------------------------------------------
+// parseField(value, ok)
+//   Parse an unsigned decimal field in place, up to the next ',' or '\n'.
+//   Leading whitespace is skipped and, like String::toInt(), parsing stops at
+//   the first non-digit (the rest of the field is consumed and ignored).
+//   Clears *ok if the field holds no digits.
+//   Returns the delimiter, or -1 at end of file.
+// ----------------------------------------------------------------------------
+static int parseField(uint32_t* value, bool* ok) {
+    uint32_t v      = 0;
+    bool     digits = false;
+    bool     done   = false;
+    int      c;
+
+    while ((c = nextByte()) >= 0 && c != ',' && c != '\n') {
+        if (done) continue;
+        if (c >= '0' && c <= '9') {
+            v = v * 10 + (uint8_t)(c - '0');
+            digits = true;
+        } else if (digits || (c != ' ' && c != '\t')) {
+            done = true;
+        }
+    }
+
+    *value = v;
+    if (!digits) *ok = false;
+    return c;
+}
+
 // ----------------------------------------------------------------------------
 // sd_init(csPin)
 //   Initialize the SD card using the given chip-select pin.
 //   Returns true if the card is successfully initialized, false otherwise.
 // ----------------------------------------------------------------------------
 bool sd_init(uint8_t csPin) {
-    return SD.begin(csPin);
+    return hal_fs_begin(csPin);
 }
 
 // ----------------------------------------------------------------------------
 // sd_list_csv_files()
-//   Scan the root directory for files ending in “.csv” (case-insensitive).
-//   Store up to MAX_FILES names in the fileNames array.
+//   Scan the root directory for files ending in “.csv” or “.bzs”
+//   (case-insensitive). Store up to MAX_FILES names in the fileNames array.
 // ----------------------------------------------------------------------------
 void sd_list_csv_files(void) {
     fileCount = 0;
 
     // Open root directory
-    File root = SD.open("/");
-    if (!root) return;
-
-    root.rewindDirectory();
-    File entry;
-
-    // Iterate through each directory entry
-    while ((entry = root.openNextFile())) {
-        if (!entry.isDirectory()) {
-            const char* name = entry.name();
-            size_t len = strlen(name);
-
-            // Check for “.csv” extension
-            if (len > 4 && strcasecmp(name + len - 4, ".csv") == 0) {
-                if (fileCount < MAX_FILES) {
-                    // Copy filename into our array (ensuring null termination)
-                    strncpy(fileNames[fileCount], name, MAX_FN_LEN);
-                    fileNames[fileCount][MAX_FN_LEN - 1] = '\0';
-                    fileCount++;
-                }
-            }
+    HalDir root;
+    if (!root.open("/")) return;
+
+    // Iterate through each regular file
+    char name[MAX_FN_LEN];
+    while (fileCount < MAX_FILES && root.next(name, sizeof(name))) {
+        size_t len = strlen(name);
+
+        // Check for “.csv” or binary song extension
+        if (len > 4 && (strcasecmp(name + len - 4, ".csv") == 0 ||
+                        strcasecmp(name + len - 4, SONG_EXT) == 0)) {
+            // Copy filename into our array (already null-terminated)
+            memcpy(fileNames[fileCount], name, MAX_FN_LEN);
+            fileCount++;
         }
-        entry.close();
     }
 
     root.close();
@@ -79,10 +183,64 @@ const char* sd_get_file_name(uint8_t idx) {
     return nullptr;
 }
 
+// ----------------------------------------------------------------------------
+// detectFormat()
+//   Check the start of the freshly opened file for SONG_MAGIC.
+//   On a match, validate the SongHeader and position the file at the first
+//   record. Otherwise leave readBuf untouched so the CSV header can be
+//   skipped from it. Returns the file's SONG_FMT_* value, SD_FMT_CSV for
+//   text, and clears *supported if it uses a format this build cannot decode.
+// ----------------------------------------------------------------------------
+static uint8_t detectFormat(bool* supported) {
+    *supported = true;
+    fillBuffer();
+    if (readLen < SONG_HEADER_MIN_SIZE ||
+        memcmp(readBuf, SONG_MAGIC, SONG_MAGIC_LEN) != 0) {
+        return SD_FMT_CSV;
+    }
+
+    // Packed little-endian header, same byte order as every supported target.
+    // Optional fields beyond the file's headerSize read as 0.
+    SongHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(&hdr, readBuf, SONG_HEADER_MIN_SIZE);
+    uint16_t known = hdr.headerSize < sizeof(hdr) ? hdr.headerSize : sizeof(hdr);
+    if (known > readLen) known = readLen;
+    if (known > SONG_HEADER_MIN_SIZE) {
+        memcpy((uint8_t*)&hdr + SONG_HEADER_MIN_SIZE, readBuf + SONG_HEADER_MIN_SIZE,
+               known - SONG_HEADER_MIN_SIZE);
+    }
+
+    if ((hdr.format != SONG_FMT_FIXED && hdr.format != SONG_FMT_DELTA)
+        || hdr.headerSize < SONG_HEADER_MIN_SIZE) {
+        *supported = false;
+        return hdr.format;
+    }
+
+    // Records begin right after the (possibly extended) header
+    if (hdr.headerSize <= readLen) {
+        readPos = hdr.headerSize;
+    } else {
+        noteFile.seek(hdr.headerSize);
+        readPos = readLen = 0;
+    }
+    eventCount   = hdr.eventCount;
+    eventsLeft   = hdr.eventCount;
+    recordsStart = hdr.headerSize;
+    deltaBase    = 0;
+
+    timeScale             = hdr.tickUs ? hdr.tickUs : SONG_TICK_US_DEFAULT;
+    songInfo.eventCount   = hdr.eventCount;
+    songInfo.duration     = hdr.duration * timeScale;
+    songInfo.maxPolyphony = hdr.maxPolyphony;
+    return hdr.format;
+}
+
 // ----------------------------------------------------------------------------
 // sd_open_file(filename)
-//   Close any previously open file and open the specified CSV.
-//   Skip the header row and reset the finished flag.
+//   Close any previously open file and open the specified song.
+//   Binary songs are recognized by their magic bytes; anything else is
+//   parsed as CSV and has its header row skipped.
 //   Returns true on success, false on failure.
 // ----------------------------------------------------------------------------
 bool sd_open_file(const char* filename) {
@@ -92,70 +250,296 @@ bool sd_open_file(const char* filename) {
     }
 
     // Open new file
-    noteFile = SD.open(filename);
-    if (!noteFile) {
+    if (!noteFile.open(filename, HAL_FILE_READ)) {
+        finished = true;
+        return false;
+    }
+
+    // Reset the read-ahead buffer and statistics for the new file
+    readPos = 0;
+    readLen = 0;
+    lineNo  = 0;
+    memset(&readStats, 0, sizeof(readStats));
+    memset(&songInfo, 0, sizeof(songInfo));
+    timeScale = SONG_TICK_US_DEFAULT;
+
+    bool supported;
+    songFormat = detectFormat(&supported);
+    if (!supported) {
+        hal_println(F("Unsupported song format"));
+        noteFile.close();
         finished = true;
         return false;
     }
 
     // Skip header line (column names)
-    sd_skip_header();
+    if (songFormat == SD_FMT_CSV) {
+        sd_skip_header();
+    }
+    songInfo.tickUs = timeScale;
     finished = false;
     return true;
 }
 
 // ----------------------------------------------------------------------------
 // sd_skip_header()
-//   Read and discard characters up to the first newline.
-//   Used to skip the CSV header row.
+//   Read and discard bytes up to the first newline, watching for a column
+//   name ending in "_us" (as written by midi_csv_generator) to select µs
+//   times. Used to skip the CSV header row.
 // ----------------------------------------------------------------------------
 void sd_skip_header(void) {
-    noteFile.readStringUntil('\n');
+    int     c;
+    uint8_t matched = 0;    // Characters of "_us" seen so far
+    bool    micros  = false;
+    while ((c = nextByte()) >= 0 && c != '\n') {
+        if (matched == 3 && (c == ',' || c == '\r' || c == ' ')) {
+            micros = true;
+        }
+        if (c == '_') {
+            matched = 1;
+        } else if (matched && c == "_us"[matched]) {
+            matched++;
+        } else {
+            matched = 0;
+        }
+    }
+    if (matched == 3) micros = true;
+    timeScale = micros ? 1 : SONG_TICK_US_DEFAULT;
+    lineNo++;
 }
 
 // ----------------------------------------------------------------------------
-// sd_read_next_event(event)
-//   Read the next non-empty CSV line and parse it into a NoteEvent.
+// readCsvEvent(event)
+//   Parse the next non-empty CSV line into a NoteEvent.
+//   Lines are tokenized directly from the read-ahead buffer; blank lines are
+//   skipped and malformed lines are reported on Serial and skipped.
 //   Returns true if an event was successfully read, false if EOF or error.
 // ----------------------------------------------------------------------------
-bool sd_read_next_event(NoteEvent* event) {
-    // If already finished or no data, signal EOF
-    if (finished || !noteFile.available()) {
+static bool readCsvEvent(NoteEvent* event) {
+    while (true) {
+        // Column 0 (index or note name) is ignored
+        bool nonBlank = false;
+        int  c = skipField(&nonBlank);
+        lineNo++;
+
+        if (c < 0 && !nonBlank) {
+            // Clean end of file
+            finished = true;
+            return false;
+        }
+        if (c != ',') {
+            if (nonBlank) {
+                hal_print(F("CSV parse error, line "));
+                hal_println(lineNo);
+            }
+            if (c < 0) {
+                finished = true;
+                return false;
+            }
+            continue;  // blank line
+        }
+
+        // Columns 1..4: frequency, start, end, buzzer
+        uint32_t field[4];
+        bool     ok = true;
+        for (uint8_t n = 0; n < 4 && ok; n++) {
+            c = parseField(&field[n], &ok);
+            if (n < 3 && c != ',') ok = false;
+        }
+
+        // Discard the rest of the line (extra trailing columns are tolerated)
+        while (c == ',') {
+            bool extra = false;
+            c = skipField(&extra);
+        }
+
+        if (!ok) {
+            hal_print(F("CSV parse error, line "));
+            hal_println(lineNo);
+            if (c < 0) {
+                finished = true;
+                return false;
+            }
+            continue;
+        }
+
+        event->note      = pitch_hz_to_note((uint16_t)field[0]);
+        event->startTime = field[1];
+        event->endTime   = field[2];
+        event->buzzer    = (uint8_t)field[3];
+        return true;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// readBinaryEvent(event)
+//   Decode the next fixed-size record into a NoteEvent.
+//   Returns true if a record was read, false at the end of the song.
+// ----------------------------------------------------------------------------
+static bool readBinaryEvent(NoteEvent* event) {
+    if (eventsLeft == 0) {
         finished = true;
         return false;
     }
 
-    // Read next line up to newline
-    String line = noteFile.readStringUntil('\n');
-    line.trim();
+    uint8_t rec[SONG_RECORD_SIZE];
+    if (readBytes(rec, SONG_RECORD_SIZE) != SONG_RECORD_SIZE) {
+        finished = true;
+        return false;
+    }
+    event->note      = pitch_hz_to_note(rec[0] | ((uint16_t)rec[1] << 8));
+    event->startTime = rec[2] | ((uint32_t)rec[3] << 8)
+                     | ((uint32_t)rec[4] << 16) | ((uint32_t)rec[5] << 24);
+    event->endTime   = rec[6] | ((uint32_t)rec[7] << 8)
+                     | ((uint32_t)rec[8] << 16) | ((uint32_t)rec[9] << 24);
+    event->buzzer    = rec[10];
+
+    eventsLeft--;
+    return true;
+}
 
-    // Skip empty lines recursively
-    if (line.length() == 0) {
-        return sd_read_next_event(event);
+// ----------------------------------------------------------------------------
+// readVarint(value)
+//   Decode one unsigned LEB128 varint from the read-ahead buffer.
+//   Returns the number of bytes consumed, 0 at end of file or if the varint
+//   is truncated or longer than SONG_VARINT_MAX_BYTES.
+// ----------------------------------------------------------------------------
+static uint8_t readVarint(uint32_t* value) {
+    uint32_t v     = 0;
+    uint8_t  shift = 0;
+    for (uint8_t n = 1; n <= SONG_VARINT_MAX_BYTES; n++) {
+        int c = nextByte();
+        if (c < 0) return 0;
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *value = v;
+            return n;
+        }
+        shift += 7;
+    }
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// readDeltaEvent(event)
+//   Decode the next delta/varint record into a NoteEvent. The start time is
+//   accumulated from deltaBase; the note number is used as is.
+//   Returns true if a record was read, false at the end of the song.
+// ----------------------------------------------------------------------------
+static bool readDeltaEvent(NoteEvent* event) {
+    uint32_t delta, duration;
+    uint8_t  tail[2];
+    if (!readVarint(&delta) || !readVarint(&duration)
+        || readBytes(tail, sizeof(tail)) != sizeof(tail)) {
+        finished = true;
+        return false;
     }
 
-    // Find commas separating columns: frequency,start,end,buzzer
-    int i1 = line.indexOf(',');
-    int i2 = line.indexOf(',', i1 + 1);
-    int i3 = line.indexOf(',', i2 + 1);
-    int i4 = line.indexOf(',', i3 + 1);
+    deltaBase       += delta;
+    event->note      = tail[0];
+    event->startTime = deltaBase;
+    event->endTime   = deltaBase + duration;
+    event->buzzer    = tail[1];
+    return true;
+}
 
-    // If format is invalid, log error and skip line
-    if (i1 < 0 || i2 < 0 || i3 < 0 || i4 < 0) {
-        Serial.print("CSV parse error: "); 
-        Serial.println(line);
-        return sd_read_next_event(event);
+// ----------------------------------------------------------------------------
+// sd_read_next_event(event)
+//   Read the next NoteEvent from the open song, in whichever format it uses,
+//   and account the time spent in readStats.
+//   Returns true if an event was successfully read, false if EOF or error.
+// ----------------------------------------------------------------------------
+bool sd_read_next_event(NoteEvent* event) {
+    if (finished) {
+        return false;
     }
 
-    // Parse each field into the NoteEvent struct
-    event->frequency = line.substring(i1 + 1, i2).toInt();
-    event->startTime = line.substring(i2 + 1, i3).toInt();
-    event->endTime   = line.substring(i3 + 1, i4).toInt();
-    event->buzzer    = line.substring(i4 + 1).toInt();
+    uint32_t t0 = hal_micros();
+    bool ok;
+    switch (songFormat) {
+        case SONG_FMT_FIXED: ok = readBinaryEvent(event); break;
+        case SONG_FMT_DELTA: ok = readDeltaEvent(event);  break;
+        default:             ok = readCsvEvent(event);    break;
+    }
+    if (!ok) {
+        return false;
+    }
+    if (timeScale != 1) {
+        event->startTime *= timeScale;
+        event->endTime   *= timeScale;
+    }
+
+    // Record how long this event took to produce (including any refill)
+    uint32_t dt = hal_micros() - t0;
+    readStats.events++;
+    readStats.totalUs += dt;
+    if (dt > readStats.maxUs) readStats.maxUs = dt;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// sd_tell()
+//   Byte offset of the next unread event: the file position minus whatever
+//   is still waiting in the read-ahead buffer.
+// ----------------------------------------------------------------------------
+uint32_t sd_tell(void) {
+    return noteFile.position() - (uint32_t)(readLen - readPos);
+}
+
+// ----------------------------------------------------------------------------
+// sd_time_base()
+//   Start time the next delta record is relative to (0 for other formats).
+// ----------------------------------------------------------------------------
+uint32_t sd_time_base(void) {
+    return (songFormat == SONG_FMT_DELTA) ? deltaBase : 0;
+}
 
+// ----------------------------------------------------------------------------
+// sd_seek(offset, timeBase)
+//   Reposition the open song at an event boundary previously returned by
+//   sd_tell(), discarding the read-ahead buffer. timeBase is the matching
+//   sd_time_base() value, needed to resume decoding a delta stream.
+//   Returns true on success, false if no file is open or the seek failed.
+// ----------------------------------------------------------------------------
+bool sd_seek(uint32_t offset, uint32_t timeBase) {
+    bool binary = (songFormat != SD_FMT_CSV);
+    if (!noteFile || (binary && offset < recordsStart) || !noteFile.seek(offset)) {
+        return false;
+    }
+    readPos = readLen = 0;
+    if (songFormat == SONG_FMT_FIXED) {
+        uint32_t done = (offset - recordsStart) / SONG_RECORD_SIZE;
+        eventsLeft = (done < eventCount) ? eventCount - done : 0;
+    }
+    deltaBase = timeBase;
+    finished  = false;
     return true;
 }
 
+// ----------------------------------------------------------------------------
+// sd_file_size()
+//   Size in bytes of the open song, or 0 if none is open.
+// ----------------------------------------------------------------------------
+uint32_t sd_file_size(void) {
+    return noteFile ? noteFile.size() : 0;
+}
+
+// ----------------------------------------------------------------------------
+// sd_get_song_info()
+//   Return the header metadata of the open song.
+// ----------------------------------------------------------------------------
+const SongInfo* sd_get_song_info(void) {
+    return &songInfo;
+}
+
+// ----------------------------------------------------------------------------
+// sd_get_read_stats()
+//   Return parse cost statistics for the currently open file.
+// ----------------------------------------------------------------------------
+const SdReadStats* sd_get_read_stats(void) {
+    return &readStats;
+}
+
 // ----------------------------------------------------------------------------
 // sd_finished()
 //   Return true if all events have been read or an error occurred.
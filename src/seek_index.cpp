@@ -0,0 +1,199 @@
+// seek_index.cpp
+// Builds and queries the per-song seek index sidecar (see song_format.h).
+
+#include "seek_index.h"
+#include "player.h"
+#include "voices.h"
+
+#if NUM_BUZZERS > INDEX_MAX_VOICES
+#error "NUM_BUZZERS must not exceed INDEX_MAX_VOICES"
+#endif
+
+// --- Static module state ---
+// File handle of the open index and its validated header
+static HalFile     indexFile;
+static IndexHeader indexHeader;
+
+// ----------------------------------------------------------------------------
+// seek_index_name(songName, out)
+//   "<base>.I<xx>", where xx are the first two letters of the song's
+//   extension (see song_format.h).
+// ----------------------------------------------------------------------------
+void seek_index_name(const char* songName, char* out) {
+    strncpy(out, songName, MAX_FN_LEN - 1);
+    out[MAX_FN_LEN - 1] = '\0';
+
+    char  ext[2] = { 0, 0 };
+    char* dot    = strrchr(out, '.');
+    if (dot) {
+        for (uint8_t i = 0; i < 2 && dot[i + 1]; i++) ext[i] = dot[i + 1];
+    } else {
+        dot = out + strlen(out);
+    }
+    if (dot - out > MAX_FN_LEN - 5) dot = out + MAX_FN_LEN - 5;
+
+    bool lower = ext[0] >= 'a' && ext[0] <= 'z';
+    *dot++ = '.';
+    *dot++ = lower ? INDEX_EXT_PREFIX - 'A' + 'a' : INDEX_EXT_PREFIX;
+    for (uint8_t i = 0; i < 2 && ext[i]; i++) *dot++ = ext[i];
+    *dot = '\0';
+}
+
+// ----------------------------------------------------------------------------
+// openIndex(indexName, songSize)
+//   Open an existing index and check that it matches the song.
+//   Returns true if the index is usable.
+// ----------------------------------------------------------------------------
+static bool openIndex(const char* indexName, uint32_t songSize) {
+    if (!indexFile.open(indexName, HAL_FILE_READ)) return false;
+
+    if (indexFile.read(&indexHeader, sizeof(indexHeader)) == sizeof(indexHeader)
+        && memcmp(indexHeader.magic, INDEX_MAGIC, SONG_MAGIC_LEN) == 0
+        && indexHeader.version    == INDEX_VERSION
+        && indexHeader.buzzers    == NUM_BUZZERS
+        && indexHeader.interval   != 0
+        && indexHeader.songSize   == songSize) {
+        return true;
+    }
+
+    indexFile.close();
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// snapshotVoices(entry)
+//   Copy the voice table into entry, leaving out notes ended by entry.time.
+// ----------------------------------------------------------------------------
+static void snapshotVoices(IndexEntry& entry) {
+    memset(entry.voices, 0, sizeof(entry.voices));
+    for (uint8_t v = 0; v < NUM_BUZZERS; v++) {
+        if (voices_busy(v) && voices_end_time(v) > entry.time) {
+            IndexVoice& iv = entry.voices[v];
+            iv.note      = voices_note(v);
+            iv.startTime = voices_start_time(v);
+            iv.endTime   = voices_end_time(v);
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// buildIndex(indexName)
+//   Scan the open song from its first event and write a fresh index.
+//   One entry is emitted for every checkpoint before each event's start,
+//   recording the file offset of that event and the voice table, which the
+//   scan drives like playback does, so unassigned notes land where they
+//   would at run time.
+//   Returns true if the index was written completely.
+// ----------------------------------------------------------------------------
+static bool buildIndex(const char* indexName) {
+    HalFile out;
+    if (!out.open(indexName, HAL_FILE_CREATE)) return false;
+
+    IndexHeader hdr;
+    memcpy(hdr.magic, INDEX_MAGIC, SONG_MAGIC_LEN);
+    hdr.version    = INDEX_VERSION;
+    hdr.buzzers    = NUM_BUZZERS;
+    hdr.headerSize = sizeof(IndexHeader);
+    hdr.interval   = INDEX_INTERVAL;
+    hdr.songSize   = sd_file_size();
+    hdr.entryCount = 0;
+    out.write(&hdr, sizeof(hdr));
+
+    // The voice table is replayed as player_update() would drive it; the
+    // player is stopped while a song is being prepared
+    voices_reset();
+    IndexEntry entry;
+
+    NoteEvent ev;
+    uint32_t  checkpoint = 0;
+    uint32_t  offset     = sd_tell();
+    uint32_t  base       = sd_time_base();
+    bool      ok         = true;
+
+    while (ok && sd_read_next_event(&ev)) {
+        // Emit every checkpoint this event starts after
+        while (ev.startTime > checkpoint) {
+            entry.time     = checkpoint;
+            entry.offset   = offset;
+            entry.baseTime = base;
+            snapshotVoices(entry);
+            if (out.write(&entry, sizeof(entry)) != sizeof(entry)) {
+                ok = false;
+                break;
+            }
+            hdr.entryCount++;
+            checkpoint += INDEX_INTERVAL;
+        }
+
+        // Same voice as voiceFor() in player.cpp picks
+        if (ev.buzzer == 0) {
+            voices_start(voices_allocate(NUM_BUZZERS, ev.startTime),
+                         ev.startTime, ev.endTime, ev.note);
+        } else if (ev.buzzer <= NUM_BUZZERS) {
+            voices_start(ev.buzzer - 1, ev.startTime, ev.endTime, ev.note);
+        }
+        offset = sd_tell();
+        base   = sd_time_base();
+    }
+
+    // Patch the final entry count into the header
+    out.seek(0);
+    if (out.write(&hdr, sizeof(hdr)) != sizeof(hdr)) ok = false;
+    out.close();
+    voices_reset();
+
+    if (!ok) hal_fs_remove(indexName);
+    return ok;
+}
+
+// ----------------------------------------------------------------------------
+// seek_index_prepare(songName)
+//   Open the song's index, rebuilding it if missing or stale, and leave the
+//   song reopened at its first event.
+// ----------------------------------------------------------------------------
+bool seek_index_prepare(const char* songName) {
+    char indexName[MAX_FN_LEN];
+    seek_index_name(songName, indexName);
+    seek_index_close();
+
+    uint32_t songSize = sd_file_size();
+    if (openIndex(indexName, songSize)) {
+        return true;
+    }
+
+    hal_print(F("Building seek index "));
+    hal_println(indexName);
+    bool built = buildIndex(indexName);
+
+    // The scan consumed the song; rewind it for playback
+    sd_open_file(songName);
+    return built && openIndex(indexName, songSize);
+}
+
+// ----------------------------------------------------------------------------
+// seek_index_close()
+//   Release the index file handle.
+// ----------------------------------------------------------------------------
+void seek_index_close(void) {
+    if (indexFile) {
+        indexFile.close();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// seek_index_lookup(time, entry)
+//   Entries are evenly spaced, so the checkpoint at or before time is read
+//   with a single seek; times past the last entry use the last one.
+// ----------------------------------------------------------------------------
+bool seek_index_lookup(unsigned long time, IndexEntry* entry) {
+    if (!indexFile || indexHeader.entryCount == 0) {
+        return false;
+    }
+
+    uint32_t n = time / indexHeader.interval;
+    if (n >= indexHeader.entryCount) n = indexHeader.entryCount - 1;
+
+    uint32_t pos = indexHeader.headerSize + n * (uint32_t)sizeof(IndexEntry);
+    return indexFile.seek(pos)
+        && indexFile.read(entry, sizeof(IndexEntry)) == sizeof(IndexEntry);
+}
@@ -0,0 +1,295 @@
+// tone_dds.cpp
+// Single-timer phase accumulator tone engine (see tone_dds.h).
+
+#if defined(ARDUINO) && defined(HAL_TONE_DDS)
+
+#include "tone_dds.h"
+
+// Timer1 ticks (CPU cycles, no prescaler) per accumulator tick
+#define DDS_TICK_CYCLES  (F_CPU / TONE_DDS_RATE)
+
+#if DDS_TICK_CYCLES > 65536
+#error "TONE_DDS_RATE too low for timer1 without a prescaler"
+#endif
+
+// Accumulators are stored grouped by port, in the order the tick walks them
+struct DdsVoice {
+    uint16_t phase;     // Bit 15 mirrors the pin level
+    uint16_t inc;       // 0 = silent
+    uint8_t  mask;      // Pin bit in its port
+    uint8_t  port;      // Index into ports[]
+};
+
+struct DdsPort {
+    volatile uint8_t* pinReg;   // PINx: writing a mask toggles those pins
+    volatile uint8_t* portReg;  // PORTx: for driving pins low on stop
+    uint8_t           voices;   // Consecutive entries in voices[]
+};
+
+// --- Static module state ---
+static DdsVoice voices[TONE_DDS_VOICES];
+static DdsPort  ports[TONE_DDS_VOICES];
+static uint8_t  portCount;
+static uint8_t  voiceCount;                     // Attached voices
+static bool     attached[TONE_DDS_VOICES];
+static uint8_t  slotOf[TONE_DDS_VOICES];        // HAL voice → voices[] entry
+static uint8_t  pinOf[TONE_DDS_VOICES];
+static bool     timerRunning = false;
+
+#ifdef TONE_DDS_PROFILE
+// Interrupt cycles, by number of voices that were sounding
+struct DdsLoad {
+    uint32_t totalCycles;
+    uint16_t ticks;
+    uint16_t maxCycles;
+};
+static volatile DdsLoad load[TONE_DDS_VOICES + 1];
+#endif
+
+// Increment per MIDI note: f * 65536 / TONE_DDS_RATE, rounded, from the
+// note's frequency in mHz in octave -1; each octave up doubles it. Notes
+// at or above half the tick rate are clamped just below it.
+constexpr uint16_t dds_octave_mhz[12] = {
+    8176, 8662, 9177, 9723, 10301, 10913, 11562, 12250, 12978, 13750, 14568, 15434
+};
+
+constexpr uint32_t dds_inc_raw(uint8_t note) {
+    return (uint32_t)((((uint64_t)dds_octave_mhz[note % 12] << (note / 12)) * 65536
+                       + TONE_DDS_RATE * 500) / (TONE_DDS_RATE * 1000));
+}
+
+constexpr uint16_t dds_inc(uint8_t note) {
+    return dds_inc_raw(note) > 0x7FFF ? 0x7FFF : (uint16_t)dds_inc_raw(note);
+}
+
+#define DDS_NOTES_8(n) \
+    dds_inc(n), dds_inc(n + 1), dds_inc(n + 2), dds_inc(n + 3), \
+    dds_inc(n + 4), dds_inc(n + 5), dds_inc(n + 6), dds_inc(n + 7)
+
+static const uint16_t noteInc[128] PROGMEM = {
+    DDS_NOTES_8(0),  DDS_NOTES_8(8),  DDS_NOTES_8(16),  DDS_NOTES_8(24),
+    DDS_NOTES_8(32), DDS_NOTES_8(40), DDS_NOTES_8(48),  DDS_NOTES_8(56),
+    DDS_NOTES_8(64), DDS_NOTES_8(72), DDS_NOTES_8(80),  DDS_NOTES_8(88),
+    DDS_NOTES_8(96), DDS_NOTES_8(104), DDS_NOTES_8(112), DDS_NOTES_8(120)
+};
+
+// ----------------------------------------------------------------------------
+// Accumulator tick
+//   Port by port: the pins whose accumulator crossed bit 15 are collected
+//   in one mask and toggled with a single PINx store (TONE_DDS_BATCH=0
+//   stores per voice instead, for comparison).
+//   TCNT1 restarts at 0 on the compare match, so at the end of the handler
+//   it holds the cycles spent since the match (entry latency included, the
+//   register restore on exit not).
+// ----------------------------------------------------------------------------
+ISR(TIMER1_COMPA_vect) {
+    DdsVoice*      v = voices;
+    const DdsPort* p = ports;
+#ifdef TONE_DDS_PROFILE
+    uint8_t sounding = 0;
+#endif
+    for (uint8_t g = portCount; g; g--, p++) {
+#if TONE_DDS_BATCH
+        uint8_t toggle = 0;
+#endif
+        for (uint8_t i = p->voices; i; i--, v++) {
+            uint16_t inc = v->inc;
+            if (!inc) continue;
+            uint16_t old = v->phase;
+            uint16_t now = old + inc;
+            v->phase = now;
+            if ((old ^ now) & 0x8000) {
+#if TONE_DDS_BATCH
+                toggle |= v->mask;
+#else
+                *p->pinReg = v->mask;
+#endif
+            }
+#ifdef TONE_DDS_PROFILE
+            sounding++;
+#endif
+        }
+#if TONE_DDS_BATCH
+        if (toggle) *p->pinReg = toggle;
+#endif
+    }
+
+#ifdef TONE_DDS_PROFILE
+    volatile DdsLoad& l = load[sounding];
+    uint16_t cycles = TCNT1;
+    l.totalCycles += cycles;
+    l.ticks++;
+    if (cycles > l.maxCycles) l.maxCycles = cycles;
+    if (l.ticks == 0xFFFF) {        // Keep the average, halve the weight
+        l.totalCycles >>= 1;
+        l.ticks >>= 1;
+    }
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// startTimer()
+//   Timer1 in CTC mode, no prescaler, interrupt on compare A.
+// ----------------------------------------------------------------------------
+static void startTimer(void) {
+    uint8_t irq = hal_irq_save();
+    TCCR1A = 0;
+    TCCR1B = _BV(WGM12) | _BV(CS10);
+    OCR1A  = DDS_TICK_CYCLES - 1;
+    TCNT1  = 0;
+    TIMSK1 = _BV(OCIE1A);
+    hal_irq_restore(irq);
+    timerRunning = true;
+}
+
+// ----------------------------------------------------------------------------
+// regroup()
+//   Lay voices[] out port by port, in order of each port's first voice,
+//   carrying over each attached voice's state. Interrupts must be off.
+// ----------------------------------------------------------------------------
+static void regroup(void) {
+    DdsVoice old[TONE_DDS_VOICES];
+    uint8_t  oldSlot[TONE_DDS_VOICES];
+    memcpy(old, voices, sizeof(old));
+    memcpy(oldSlot, slotOf, sizeof(oldSlot));
+
+    uint8_t slots = 0;
+    portCount = 0;
+    for (uint8_t first = 0; first < TONE_DDS_VOICES; first++) {
+        if (!attached[first]) continue;
+        uint8_t port = digitalPinToPort(pinOf[first]);
+        volatile uint8_t* pinReg = portInputRegister(port);
+
+        bool seen = false;
+        for (uint8_t g = 0; g < portCount; g++) {
+            if (ports[g].pinReg == pinReg) seen = true;
+        }
+        if (seen) continue;
+
+        DdsPort& p = ports[portCount];
+        p.pinReg  = pinReg;
+        p.portReg = portOutputRegister(port);
+        p.voices  = 0;
+        for (uint8_t voice = first; voice < TONE_DDS_VOICES; voice++) {
+            if (!attached[voice] || digitalPinToPort(pinOf[voice]) != port) continue;
+            voices[slots]      = old[oldSlot[voice]];
+            voices[slots].port = portCount;
+            slotOf[voice]      = slots++;
+            p.voices++;
+        }
+        portCount++;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// tone_dds_begin(voice, pin)
+// ----------------------------------------------------------------------------
+void tone_dds_begin(uint8_t voice, uint8_t pin) {
+    if (voice >= TONE_DDS_VOICES) return;
+
+    uint8_t port = digitalPinToPort(pin);
+    if (port == NOT_A_PIN) return;
+    pinMode(pin, OUTPUT);
+
+    uint8_t irq = hal_irq_save();
+    if (attached[voice]) {              // Re-attach: release the old pin
+        DdsVoice& v = voices[slotOf[voice]];
+        v.inc = 0;
+        *ports[v.port].portReg &= ~v.mask;
+    } else {                            // Entries 0..voiceCount-1 are in use
+        attached[voice] = true;
+        slotOf[voice]   = voiceCount++;
+    }
+    DdsVoice& v = voices[slotOf[voice]];
+    v.phase = 0;
+    v.inc   = 0;
+    v.mask  = digitalPinToBitMask(pin);
+    pinOf[voice] = pin;
+    *portOutputRegister(port) &= ~v.mask;
+    regroup();
+    hal_irq_restore(irq);
+
+    if (!timerRunning) startTimer();
+}
+
+// ----------------------------------------------------------------------------
+// setInc(voice, inc)
+//   The phase carries over on a retune, so the pin keeps following bit 15.
+// ----------------------------------------------------------------------------
+static void setInc(uint8_t voice, uint16_t inc) {
+    if (voice >= TONE_DDS_VOICES || !attached[voice]) return;
+    uint8_t irq = hal_irq_save();
+    voices[slotOf[voice]].inc = inc;
+    hal_irq_restore(irq);
+}
+
+void tone_dds_play(uint8_t voice, uint16_t frequency) {
+    uint32_t inc = (((uint32_t)frequency << 16) + TONE_DDS_RATE / 2) / TONE_DDS_RATE;
+    setInc(voice, inc > 0x7FFF ? 0x7FFF : (uint16_t)inc);
+}
+
+void tone_dds_play_note(uint8_t voice, uint8_t note) {
+    setInc(voice, pgm_read_word(noteInc + (note & 0x7F)));
+}
+
+// ----------------------------------------------------------------------------
+// tone_dds_stop(voice)
+//   The PORTx read-modify-write runs with interrupts off, so it cannot undo
+//   a toggle the tick makes on another pin of the same port.
+// ----------------------------------------------------------------------------
+void tone_dds_stop(uint8_t voice) {
+    if (voice >= TONE_DDS_VOICES || !attached[voice]) return;
+    uint8_t   irq = hal_irq_save();
+    DdsVoice& v   = voices[slotOf[voice]];
+    v.inc   = 0;
+    v.phase = 0;
+    *ports[v.port].portReg &= ~v.mask;
+    hal_irq_restore(irq);
+}
+
+// ----------------------------------------------------------------------------
+// tone_dds_dump_load()
+//   "[DDS] voices=<n> ticks avg_cycles max_cycles load_pct" per voice
+//   count seen; load is the average share of the tick period.
+// ----------------------------------------------------------------------------
+void tone_dds_dump_load(void) {
+    hal_print(F("[DDS] rate_hz="));
+    hal_print(TONE_DDS_RATE);
+    hal_print(F(" tick_cycles="));
+    hal_print(DDS_TICK_CYCLES);
+    hal_print(F(" batch="));
+    hal_println((uint32_t)TONE_DDS_BATCH);
+#ifdef TONE_DDS_PROFILE
+    for (uint8_t n = 0; n <= TONE_DDS_VOICES; n++) {
+        uint8_t irq = hal_irq_save();
+        DdsLoad l;
+        l.totalCycles = load[n].totalCycles;
+        l.ticks       = load[n].ticks;
+        l.maxCycles   = load[n].maxCycles;
+        load[n].totalCycles = 0;
+        load[n].ticks       = 0;
+        load[n].maxCycles   = 0;
+        hal_irq_restore(irq);
+        if (!l.ticks) continue;
+
+        uint32_t avg = l.totalCycles / l.ticks;
+        hal_print(F("[DDS] voices="));
+        hal_print(n);
+        hal_print(F(" ticks="));
+        hal_print(l.ticks);
+        hal_print(F(" avg_cycles="));
+        hal_print(avg);
+        hal_print(F(" max_cycles="));
+        hal_print(l.maxCycles);
+        uint32_t permille = (l.totalCycles * 10 / l.ticks) * 100 / DDS_TICK_CYCLES;
+        hal_print(F(" load_pct="));
+        hal_print(permille / 10);
+        hal_print(F("."));
+        hal_println(permille % 10);
+    }
+#else
+    hal_println(F("[DDS] build with -DTONE_DDS_PROFILE to measure load"));
+#endif
+}
+
+#endif // ARDUINO && HAL_TONE_DDS
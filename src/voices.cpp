@@ -0,0 +1,198 @@
+// voices.cpp
+// Per-buzzer voice table with an indexed min-heap on end time.
+
+#include "voices.h"
+
+// --- Static module state ---
+// Per-voice start and end time, song note, and its position in the heap
+// (VOICE_NONE = silent)
+struct Voice {
+    unsigned long startTime;
+    unsigned long endTime;
+    uint8_t       note;
+    uint8_t       heapPos;
+};
+
+static Voice   voices[VOICE_COUNT];
+
+// Busy voices, heap-ordered on voices[].endTime; heap[0] ends first
+static uint8_t heap[VOICE_COUNT];
+static uint8_t heapLen;
+
+static uint16_t preempted;
+
+// ----------------------------------------------------------------------------
+// heapSwap(a, b)
+//   Exchange two heap slots and keep the voices' back-pointers in step.
+// ----------------------------------------------------------------------------
+static void heapSwap(uint8_t a, uint8_t b) {
+    uint8_t va = heap[a];
+    heap[a] = heap[b];
+    heap[b] = va;
+    voices[heap[a]].heapPos = a;
+    voices[heap[b]].heapPos = b;
+}
+
+// ----------------------------------------------------------------------------
+// siftUp(pos) / siftDown(pos)
+//   Restore heap order after the end time at pos decreased / increased.
+// ----------------------------------------------------------------------------
+static void siftUp(uint8_t pos) {
+    while (pos > 0) {
+        uint8_t parent = (pos - 1) / 2;
+        if (voices[heap[parent]].endTime <= voices[heap[pos]].endTime) break;
+        heapSwap(pos, parent);
+        pos = parent;
+    }
+}
+
+static void siftDown(uint8_t pos) {
+    for (;;) {
+        uint8_t least = pos;
+        uint8_t l = 2 * pos + 1;
+        uint8_t r = l + 1;
+        if (l < heapLen && voices[heap[l]].endTime < voices[heap[least]].endTime) least = l;
+        if (r < heapLen && voices[heap[r]].endTime < voices[heap[least]].endTime) least = r;
+        if (least == pos) break;
+        heapSwap(pos, least);
+        pos = least;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// voices_reset()
+//   Mark every voice silent and empty the heap.
+// ----------------------------------------------------------------------------
+void voices_reset(void) {
+    for (uint8_t v = 0; v < VOICE_COUNT; v++) {
+        voices[v].heapPos = VOICE_NONE;
+    }
+    heapLen   = 0;
+    preempted = 0;
+}
+
+// ----------------------------------------------------------------------------
+// voices_start(voice, startTime, endTime, note)
+//   A busy voice keeps its heap slot and is re-sorted on the new end time;
+//   a silent one is appended to the heap.
+// ----------------------------------------------------------------------------
+void voices_start(uint8_t voice, unsigned long startTime, unsigned long endTime,
+                  uint8_t note) {
+    if (voice >= VOICE_COUNT) return;
+
+    Voice& v = voices[voice];
+    v.startTime = startTime;
+    v.endTime   = endTime;
+    v.note      = note;
+
+    if (v.heapPos == VOICE_NONE) {
+        v.heapPos       = heapLen;
+        heap[heapLen++] = voice;
+        siftUp(v.heapPos);
+    } else {
+        siftUp(v.heapPos);
+        siftDown(v.heapPos);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// voices_pop_expired(now)
+//   Take the heap root if its note has ended.
+// ----------------------------------------------------------------------------
+uint8_t voices_pop_expired(unsigned long now) {
+    if (heapLen == 0 || voices[heap[0]].endTime > now) {
+        return VOICE_NONE;
+    }
+
+    uint8_t voice = heap[0];
+    voices[voice].heapPos = VOICE_NONE;
+    if (--heapLen > 0) {
+        heap[0] = heap[heapLen];
+        voices[heap[0]].heapPos = 0;
+        siftDown(0);
+    }
+    return voice;
+}
+
+// ----------------------------------------------------------------------------
+// durationOf(v)
+//   Length of a voice's note in ~ms (µs >> 10), capped to 16 bits.
+// ----------------------------------------------------------------------------
+static uint16_t durationOf(const Voice& v) {
+    uint32_t d = (uint32_t)(v.endTime - v.startTime) >> 10;
+    return d > UINT16_MAX ? UINT16_MAX : (uint16_t)d;
+}
+
+// ----------------------------------------------------------------------------
+// voices_allocate(count, startTime)
+//   The keep score w_dur * (1 - dur / maxDur) + w_pitch * (1 - dist / mid)
+//   is compared scaled by maxDur * mid, which leaves only products that fit
+//   in 32 bits. Ties go to the lowest voice.
+// ----------------------------------------------------------------------------
+uint8_t voices_allocate(uint8_t count, unsigned long startTime) {
+    if (count > VOICE_COUNT) count = VOICE_COUNT;
+
+    uint16_t maxDur = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const Voice& v = voices[i];
+        if (v.heapPos == VOICE_NONE || v.endTime <= startTime) return i;
+        uint16_t d = durationOf(v);
+        if (d > maxDur) maxDur = d;
+    }
+    if (maxDur == 0) maxDur = 1;     // All notes under 1 ms: rank on pitch
+
+    uint8_t  victim = 0;
+    uint32_t lowest = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++) {
+        const Voice& v = voices[i];
+        uint8_t  dist  = v.note > VOICE_MID_PITCH ? v.note - VOICE_MID_PITCH
+                                                  : VOICE_MID_PITCH - v.note;
+        uint8_t  close = dist < VOICE_MID_PITCH ? VOICE_MID_PITCH - dist : 0;
+        uint32_t keep  = (uint32_t)VOICE_KEEP_W_DUR * VOICE_MID_PITCH * (maxDur - durationOf(v))
+                       + (uint32_t)VOICE_KEEP_W_PITCH * maxDur * close;
+        if (keep < lowest) {
+            lowest = keep;
+            victim = i;
+        }
+    }
+    if (preempted != UINT16_MAX) preempted++;
+    return victim;
+}
+
+// ----------------------------------------------------------------------------
+// voices_next_end(endTime)
+//   Peek at the heap root.
+// ----------------------------------------------------------------------------
+bool voices_next_end(unsigned long* endTime) {
+    if (heapLen == 0) return false;
+    *endTime = voices[heap[0]].endTime;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// voices_busy(voice) / voices_note(voice) / voices_start_time(voice) /
+// voices_end_time(voice) / voices_active() / voices_preempted()
+// ----------------------------------------------------------------------------
+bool voices_busy(uint8_t voice) {
+    return voice < VOICE_COUNT && voices[voice].heapPos != VOICE_NONE;
+}
+
+uint8_t voices_note(uint8_t voice) {
+    return voice < VOICE_COUNT ? voices[voice].note : 0;
+}
+
+unsigned long voices_start_time(uint8_t voice) {
+    return voice < VOICE_COUNT ? voices[voice].startTime : 0;
+}
+
+unsigned long voices_end_time(uint8_t voice) {
+    return voice < VOICE_COUNT ? voices[voice].endTime : 0;
+}
+
+uint8_t voices_active(void) {
+    return heapLen;
+}
+
+uint16_t voices_preempted(void) {
+    return preempted;
+}
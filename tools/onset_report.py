@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+tools/onset_report.py
+
+Summarize a note onset trace captured from the player (serial command 'o',
+or the native build's -o option): how late each note reached its buzzer
+compared to its scheduled song time. Prints lateness percentiles per song
+and per passage (fixed windows of song time).
+
+The capture is the raw console stream: binary frames as described in
+include/onset_trace.h, interleaved with the player's text output.
+"""
+
+import argparse
+import struct
+import sys
+
+# -----------------------------------------------------------------------------
+# Frame layout (must match include/onset_trace.h)
+# -----------------------------------------------------------------------------
+ONSET_SYNC     = b'\xA5\x5A'
+ONSET_FRAME    = struct.Struct('<2sHBIIB')
+ONSET_FLAG_OFF = 0x80
+SONG_PREFIX    = b'[TRACE] song '
+
+PERCENTILES = (50, 90, 99)
+
+
+def parse_stream(data):
+    """
+    Split a capture into songs. Returns a list of
+      (song name, records, dropped) where records are
+      (seq, off, voice, due_us, late_us) in arrival order.
+    """
+    songs = []
+    current = None
+    text = bytearray()
+    last_seq = None
+    i = 0
+    while i < len(data):
+        if data.startswith(ONSET_SYNC, i) and i + ONSET_FRAME.size <= len(data):
+            _, seq, flags, due, actual, check = ONSET_FRAME.unpack_from(data, i)
+            if sum(data[i + 2:i + ONSET_FRAME.size - 1]) & 0xFF == check:
+                if current is None:
+                    current = ['(unnamed)', [], 0]
+                    songs.append(current)
+                if last_seq is not None:
+                    current[2] += (seq - last_seq - 1) & 0xFFFF
+                last_seq = seq
+                late = (actual - due + 2**31) % 2**32 - 2**31    # wrap-safe
+                current[1].append((seq, bool(flags & ONSET_FLAG_OFF),
+                                   flags & 0x7F, due, late))
+                i += ONSET_FRAME.size
+                continue
+        c = data[i]
+        i += 1
+        if c != ord('\n'):
+            text.append(c)
+            continue
+        line = bytes(text).rstrip(b'\r')
+        text.clear()
+        if line.startswith(SONG_PREFIX):
+            current = [line[len(SONG_PREFIX):].decode('ascii', 'replace'), [], 0]
+            songs.append(current)
+            last_seq = None
+        elif line.startswith(b'[TRACE] on'):
+            last_seq = None                 # sequence restarts at 0
+    return [tuple(s) for s in songs]
+
+
+def percentile(sorted_values, p):
+    """Nearest-rank percentile of an already sorted list."""
+    rank = max(1, -(-p * len(sorted_values) // 100))
+    return sorted_values[rank - 1]
+
+
+def summarize(lates):
+    """One row of statistics for a list of lateness values (µs)."""
+    v = sorted(lates)
+    row = [len(v)] + [percentile(v, p) for p in PERCENTILES] + [v[-1]]
+    return row
+
+
+def print_table(title, rows):
+    """rows: (label, lateness list) pairs; empty lists are skipped."""
+    header = ['', 'notes'] + [f'p{p}_us' for p in PERCENTILES] + ['max_us']
+    lines = [header]
+    for label, lates in rows:
+        if lates:
+            lines.append([label] + [str(x) for x in summarize(lates)])
+    if len(lines) == 1:
+        return
+    widths = [max(len(line[c]) for line in lines) for c in range(len(header))]
+    print(title)
+    for line in lines:
+        print('  ' + '  '.join(cell.rjust(w) if c else cell.ljust(w)
+                               for c, (cell, w) in enumerate(zip(line, widths))))
+
+
+def report(songs, passage_us, include_off):
+    """Print the per-song and per-passage tables."""
+    for name, records, dropped in songs:
+        ons  = [r for r in records if not r[1]]
+        offs = [r for r in records if r[1]]
+        print(f"== {name}: {len(ons)} note on, {len(offs)} note off, "
+              f"{dropped} dropped")
+
+        rows = [('note on', [r[4] for r in ons])]
+        if include_off:
+            rows.append(('note off', [r[4] for r in offs]))
+        print_table('song', rows)
+
+        passages = {}
+        for r in (records if include_off else ons):
+            passages.setdefault(r[3] // passage_us, []).append(r[4])
+        span = passage_us / 1e6
+        print_table(f'passages ({span:g} s)',
+                    [(f'{k * span:g}-{(k + 1) * span:g} s', passages[k])
+                     for k in sorted(passages)])
+        print()
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description="Lateness percentiles from a captured note onset trace.")
+    parser.add_argument('capture', help="raw capture file ('-' for stdin)")
+    parser.add_argument('-p', '--passage', type=float, default=10.0,
+                        help="passage length in seconds of song time (default 10)")
+    parser.add_argument('--off', action='store_true',
+                        help="include note off events")
+    args = parser.parse_args()
+
+    if args.passage <= 0:
+        parser.exit(1, "Error: --passage must be positive.\n")
+    if args.capture == '-':
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, 'rb') as f:
+            data = f.read()
+
+    songs = parse_stream(data)
+    if not songs:
+        parser.exit(1, "No trace frames found.\n")
+    report(songs, int(args.passage * 1e6), args.off)